@@ -0,0 +1,88 @@
+// 直接求和基准：比较不分块（flat）和按缓存分块（tiled）两种遍历方式
+// 用法: bench_direct [-p double|mixed|float] [N1 N2 ...]   默认 N = 1000 5000 10000 20000 50000
+#include "../include/BodyStore.hpp"
+#include "../include/ForceKernels.hpp"
+#include "../include/Hardware.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace GEngine;
+
+namespace {
+
+struct Bodies {
+    AlignedVector<double> x, y, z, mass, radius, ax, ay, az;
+
+    explicit Bodies(size_t n) : x(n), y(n), z(n), mass(n), radius(n), ax(n), ay(n), az(n) {
+        std::mt19937_64 rng(12345);
+        std::uniform_real_distribution<double> pos(-1e12, 1e12);
+        std::uniform_real_distribution<double> m(1e22, 1e26);
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = pos(rng); y[i] = pos(rng); z[i] = pos(rng);
+            mass[i] = m(rng);
+            radius[i] = 1e6;
+        }
+    }
+
+    DirectSumArgs args() {
+        return { x.data(), y.data(), z.data(), mass.data(), radius.data(),
+                 ax.data(), ay.data(), az.data(), 6.67430e-11 };
+    }
+};
+
+// 返回多次运行中最快一次的毫秒数
+double timeRun(SimdLevel level, ForcePrecision precision, Bodies& bodies, size_t n, size_t tile) {
+    const size_t pairs = n * n;
+    const int repeats = static_cast<int>(std::max<size_t>(1, std::min<size_t>(10, 4000000000ull / pairs)));
+    DirectSumArgs args = bodies.args();
+    const KernelSet& kernels = ForceKernels::selectKernels(level, KernelPolicy{});
+    double best = 1e300;
+    for (int r = 0; r < repeats; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        ForceKernels::directSumAll(kernels, precision, args, n, tile);
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    ForcePrecision precision = ForcePrecision::Double;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-p" && i + 1 < argc) {
+            precision = ForceKernels::parsePrecision(argv[++i]);
+        } else {
+            sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+        }
+    }
+    if (sizes.empty()) sizes = {1000, 5000, 10000, 20000, 50000};
+
+    const SimdLevel level = ForceKernels::detectSimdLevel();
+    const size_t tile = ForceKernels::autoSourceTile();
+    std::printf("simd=%s precision=%s threads=%d L1d=%zuKB L2=%zuKB sourceTile=%zu\n",
+                ForceKernels::simdLevelName(level), ForceKernels::precisionName(precision),
+                omp_get_max_threads(),
+                Hardware::l1DataCacheSize() / 1024, Hardware::l2CacheSize() / 1024, tile);
+    std::printf("%10s %12s %12s %14s %14s %9s\n",
+                "N", "flat(ms)", "tiled(ms)", "flat(Gpair/s)", "tiled(Gpair/s)", "speedup");
+
+    for (size_t n : sizes) {
+        Bodies bodies(n);
+        double flat = timeRun(level, precision, bodies, n, 0);
+        double tiled = timeRun(level, precision, bodies, n, tile);
+        double pairs = static_cast<double>(n) * static_cast<double>(n);
+        std::printf("%10zu %12.2f %12.2f %14.3f %14.3f %8.2fx\n",
+                    n, flat, tiled, pairs / flat / 1e6, pairs / tiled / 1e6, flat / tiled);
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Barnes-Hut树基准：在几种典型分布上扫描多极阶数、叶节点容量和张角阈值theta，
+// 报告建树时间、力计算时间、每个天体的相互作用数，以及相对直接求和的加速度误差
+// 用法: bench_tree [-n N] [-s uniform|plummer|disk] [-g G]
+//   默认 N = 50000，三种分布都运行；-g 为分组遍历的组大小，默认0（逐天体遍历）
+#include "../include/BodyStore.hpp"
+#include "../include/CostZones.hpp"
+#include "../include/ForceKernels.hpp"
+#include "../include/LinearOctree.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace GEngine;
+
+namespace {
+
+constexpr double kG = 6.67430e-11;
+constexpr size_t kErrorSamples = 256;  // 误差按这么多个天体抽样，与直接求和比较
+
+// 均匀分布：边长2e12米的立方体
+// plummer：Plummer球（星团），尺度半径1e11米
+// disk：一颗恒星加上薄盘中的小天体（行星系统）
+void generate(BodyStore& store, const std::string& scenario, size_t n) {
+    std::mt19937_64 rng(2024);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+    store.clear();
+    store.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        Vector3D p;
+        double mass = 1e24;
+        if (scenario == "plummer") {
+            const double a = 1e11;
+            const double r = a / std::sqrt(std::pow(unit(rng), -2.0 / 3.0) - 1);
+            Vector3D dir(gauss(rng), gauss(rng), gauss(rng));
+            p = dir.normalizedScaled(std::min(r, 100 * a));
+        } else if (scenario == "disk") {
+            if (i == 0) {
+                mass = 2e30;
+            } else {
+                const double r = 5e10 + 4.5e12 * unit(rng);
+                const double phi = 2 * M_PI * unit(rng);
+                p = Vector3D(r * std::cos(phi), r * std::sin(phi), 1e9 * gauss(rng));
+                mass = 1e20 + 1e24 * unit(rng);
+            }
+        } else {
+            p = Vector3D(2e12 * unit(rng) - 1e12, 2e12 * unit(rng) - 1e12, 2e12 * unit(rng) - 1e12);
+        }
+        store.add(CelestialBody("b" + std::to_string(i), mass, 1e3, p, Vector3D(0, 0, 0)));
+    }
+}
+
+// 抽样天体的直接求和加速度
+std::vector<Vector3D> exactSamples(const BodyStore& store, const std::vector<size_t>& samples) {
+    std::vector<Vector3D> exact(samples.size());
+    #pragma omp parallel for
+    for (ptrdiff_t k = 0; k < static_cast<ptrdiff_t>(samples.size()); ++k) {
+        const size_t i = samples[k];
+        double ax = 0, ay = 0, az = 0;
+        for (size_t j = 0; j < store.size(); ++j) {
+            if (j == i) continue;
+            const double dx = store.px()[j] - store.px()[i];
+            const double dy = store.py()[j] - store.py()[i];
+            const double dz = store.pz()[j] - store.pz()[i];
+            const double r2 = dx * dx + dy * dy + dz * dz;
+            const double s = kG * store.mass()[j] / (r2 * std::sqrt(r2));
+            ax += dx * s; ay += dy * s; az += dz * s;
+        }
+        exact[k] = Vector3D(ax, ay, az);
+    }
+    return exact;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void runScenario(const std::string& scenario, size_t n, size_t groupSize) {
+    BodyStore store;
+    generate(store, scenario, n);
+
+    std::vector<size_t> samples;
+    for (size_t k = 0; k < std::min(n, kErrorSamples); ++k) samples.push_back(k * n / std::min(n, kErrorSamples));
+    const std::vector<Vector3D> exact = exactSamples(store, samples);
+
+    Vector3D lo, hi;
+    store.bounds(lo, hi);
+    const Vector3D center = (lo + hi) * 0.5;
+    const double halfSize = std::max({ hi.x() - lo.x(), hi.y() - lo.y(), hi.z() - lo.z() }) / 2 * 1.01;
+
+    std::printf("\n[%s] N=%zu group=%zu\n", scenario.c_str(), n, groupSize);
+    std::printf("%11s %6s %6s %9s %6s %10s %10s %12s %12s\n",
+                "multipole", "leaf", "theta", "nodes", "depth", "build(ms)", "force(ms)", "inter/body", "rms err");
+
+    for (bool quadrupole : { false, true }) {
+        for (size_t leaf : { 1, 4, 8, 16, 32, 64 }) {
+            for (double theta : { 0.3, 0.5, 0.7, 1.0 }) {
+                LinearOctree tree;
+                CostZones zones;
+                const TreeForceParams params{ theta, kG, 0.0 };
+                double build = 1e300, force = 1e300;
+                // 第一轮预热arena和负载划分，取之后的最快一次
+                for (int r = 0; r < 3; ++r) {
+                    auto t0 = std::chrono::steady_clock::now();
+                    tree.build(store, center, halfSize, TreeBuildParams{ leaf, quadrupole, groupSize });
+                    const double b = elapsedMs(t0);
+                    t0 = std::chrono::steady_clock::now();
+                    tree.computeAccelerations(store, params, ForcePrecision::Double, KernelPolicy{},
+                                              nullptr, &zones);
+                    const double f = elapsedMs(t0);
+                    if (r > 0) {
+                        build = std::min(build, b);
+                        force = std::min(force, f);
+                    }
+                }
+
+                double err2 = 0;
+                for (size_t k = 0; k < samples.size(); ++k) {
+                    const Vector3D a = store.acceleration(samples[k]);
+                    err2 += (a - exact[k]).squaredMagnitude() / exact[k].squaredMagnitude();
+                }
+                const auto stats = zones.toJson();
+                std::printf("%11s %6zu %6.2f %9zu %6d %10.2f %10.2f %12.1f %12.3e\n",
+                            quadrupole ? "quadrupole" : "monopole", leaf, theta,
+                            tree.nodeCount(), tree.depth(), build, force,
+                            stats["interactions"].get<double>() / n, std::sqrt(err2 / samples.size()));
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t n = 50000;
+    size_t groupSize = 0;
+    std::vector<std::string> scenarios;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            n = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-s" && i + 1 < argc) {
+            scenarios.push_back(argv[++i]);
+        } else if (arg == "-g" && i + 1 < argc) {
+            groupSize = std::strtoull(argv[++i], nullptr, 10);
+        }
+    }
+    if (scenarios.empty()) scenarios = { "uniform", "plummer", "disk" };
+
+    std::printf("simd=%s threads=%d\n",
+                ForceKernels::simdLevelName(ForceKernels::activeSimdLevel()), omp_get_max_threads());
+    for (const auto& scenario : scenarios) runScenario(scenario, n, groupSize);
+    return 0;
+}
@@ -1,24 +1,62 @@
 #pragma once
 
 #include "ISimulator.hpp"
-#include "OctreeNode.hpp"
+#include "LinearOctree.hpp"
+#include "BodyStore.hpp"
+#include "Integrator.hpp"
+#include <atomic>
 #include <vector>
 #include <memory>
-#include <functional>
+#include <mutex>
 
 namespace GEngine {
 
+// 发布给查询方的不可变树快照。发布后不再修改，查询方持有shared_ptr即可无锁读取；
+// 模拟同时在另一棵树上计算下一步，快照在最后一个持有者释放时销毁
+struct TreeSnapshot {
+    std::shared_ptr<const LinearOctree> tree;
+    unsigned long epoch = 0;      // 发布时已完成的步数（单调递增），增删天体后发布的快照沿用当时的值
+    nlohmann::json diagnostics;   // 发布时的树、根立方体、负载划分等统计
+};
+
 class BarnesHutSimulator : public ISimulator {
 private:
-    std::vector<std::shared_ptr<CelestialBody>> bodies_;
-    std::unique_ptr<OctreeNode> root_;
+    BodyStore bodies_;
+    // 力计算用的树。每步完成后连同步数作为只读快照发布给引力场查询和诊断，发布后不再修改；
+    // 下一步的第一次力计算改在一棵备用树上更新，本步之后的力计算在同一棵树上原地更新。
+    // 备用树最多保留kSpareTrees棵（由旧到新），查询方仍持有上一个快照时可改用更早的一棵，不必重新建树
+    static constexpr size_t kSpareTrees = 2;
+    std::shared_ptr<LinearOctree> tree_;
+    std::vector<std::shared_ptr<LinearOctree>> spareTrees_;
+    // 只通过std::atomic_load/atomic_store访问，只在持有mutex_时发布：step()完成时发布本步的树；
+    // 增删天体、reset()只把快照标记为过期，由之后第一次查询（currentSnapshot）建树发布。添加第一个天体之前为空
+    mutable std::shared_ptr<const TreeSnapshot> snapshot_;
+    mutable std::atomic<bool> snapshotStale_{ false };
+    mutable std::mutex mutex_;  // step()、增删天体、reset()、天体状态和事件的读取以及过期快照的重建互斥
+    std::atomic<unsigned long> epoch_{ 0 };  // 已完成的步数
+    RootCube rootCube_;
+    CostZones costZones_;  // 力计算的负载划分，跨步保留各天体的代价
+    std::unique_ptr<IIntegrator> integrator_;  // 按配置选择，跨步保留（rk45的子步长）
     std::vector<nlohmann::json> eventLog; // 存储事件
+    std::vector<std::pair<uint32_t, uint32_t>> contacts_;  // 碰撞查询的结果，跨步复用
 
     void buildOctree();
+    // 发布tree_为本步的快照
+    void publishSnapshot();
+    // 在当前天体上另建一棵树作为快照发布，调用方持有mutex_
+    void publishBodiesSnapshot() const;
+    // 最近发布的快照；已过期时取得mutex_重建（同时到达的查询只有一个重建）
+    std::shared_ptr<const TreeSnapshot> currentSnapshot() const;
+    // 本步的统计：树的部分取自tree，其余取自模拟器当前状态
+    nlohmann::json stepDiagnostics(const LinearOctree& tree) const;
+    // 在当前位置建树并计算加速度；kick非空时同时做后半步kick。
+    // previousAccelerations表示store中的加速度是上一步的结果，可供Relative判据使用
+    void computeForces(const VelocityKick* kick, bool previousAccelerations);
 
 public:
     // 基本操作
     void addBody(std::shared_ptr<CelestialBody> body) override;
+    void addBodies(const std::vector<std::shared_ptr<CelestialBody>>& bodies) override;
     void removeBody(const std::string& name) override;
     void clear() override;
     
@@ -33,49 +71,20 @@ public:
     // 配置
     void configure(const nlohmann::json& config) override;
 
-    // 实现引力场计算（使用Barnes-Hut算法）
-    Vector3D calculateGravitationalField(const Vector3D& position) const override {
-        if (!root_) {
-            const_cast<BarnesHutSimulator*>(this)->buildOctree();
-        }
-
-        Vector3D totalField(0, 0, 0);
-        const auto& config = SimulationConfig::getInstance();
-
-        // 使用Barnes-Hut树结构计算引力场
-        std::function<void(const OctreeNode*, const Vector3D&)> calculateField = 
-            [&](const OctreeNode* node, const Vector3D& pos) {
-                if (!node || (node->getTotalMass() < 1e-10)) return;
+    // 诊断信息取自最近发布的快照（含其epoch），可与step()并发；还没有快照时只有 "snapshot": null。
+    // 快照因增删天体过期时，等正在进行的step()完成后重建
+    nlohmann::json getDiagnostics() const override;
 
-                Vector3D r = pos - node->getCenterOfMass();
-                double distance = r.magnitude();
-
-                // 如果节点足够远，使用其质心近似
-                if (node->getSize() / distance < config.barnesHutTheta) {
-                    if (distance > 0) {
-                        double fieldMagnitude = config.gravityConstant * node->getTotalMass() / 
-                                             (distance * distance);
-                        totalField = totalField + r.normalize() * (-fieldMagnitude);
-                    }
-                }
-                // 否则递归计算子节点
-                else {
-                    for (int i = 0; i < 8; ++i) {
-                        if (const auto& child = node->getChild(i)) {
-                            calculateField(child.get(), pos);
-                        }
-                    }
-                }
-            };
-
-        calculateField(root_.get(), position);
-        return totalField;
-    }
+    // 引力场查询：在最近发布的树快照上遍历（使用Barnes-Hut算法），不读取天体和力计算用的树，可与step()并发。
+    // 还没有快照时（添加天体之前）引力场为0，快照过期时同诊断信息
+    Vector3D calculateGravitationalField(const Vector3D& position) const override;
+    void calculateGravitationalFields(const Vector3D* positions, Vector3D* fields, size_t n) const override;
 
-    //碰撞检测
+    //碰撞检测：在本步建好的树上查找接触的天体对，事件按 (i, j) 升序记录
     void detectCollisions();
 
     std::vector<nlohmann::json> getEvents() override {
+            std::lock_guard<std::mutex> lock(mutex_);
             auto temp = eventLog;
             eventLog.clear();
             return temp;
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "CelestialBody.hpp"
+#include "Vector3D.hpp"
+#include "ForceKernels.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace GEngine {
+
+// 按缓存行对齐的分配器，保证SoA数组的起始地址满足SIMD对齐加载
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        std::size_t bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+        void* p = std::aligned_alloc(Alignment, bytes == 0 ? Alignment : bytes);
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, std::size_t) noexcept { std::free(p); }
+
+    // 无参构造时默认初始化：double等平凡类型不写内存。
+    // resize后由工作线程首次写入，页面才会分配在写入线程所在的NUMA节点上
+    template <typename U>
+    void construct(U* p) noexcept { ::new (static_cast<void*>(p)) U; }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// 结构体数组（SoA）形式的天体存储。
+// 位置、速度、加速度、质量、半径各自连续存放，供力计算和积分的内层循环直接访问；
+// 名称等冷数据单独存放，只在API边界使用。CelestialBody仅作为JSON/HTTP层的视图。
+class BodyStore {
+private:
+    AlignedVector<double> x_, y_, z_;
+    AlignedVector<double> vx_, vy_, vz_;
+    AlignedVector<double> ax_, ay_, az_;
+    AlignedVector<double> mass_, radius_;
+    std::vector<std::string> names_;
+
+    // 名称 -> 下标（升序）的哈希索引，只供API边界按名称查找；
+    // 物理计算一律用下标区分天体，同名的天体互不影响
+    std::unordered_map<std::string, std::vector<uint32_t>> nameIndex_;
+
+    // 各线程首次写入的下标范围及所在NUMA节点（内核编号），placeForThreads()记录，供诊断使用
+    struct Partition {
+        size_t begin;
+        size_t end;
+        int node;
+    };
+    std::vector<Partition> partitions_;
+    bool placed_ = false;  // 增删天体后置为false
+
+    // ax/ay/az是否是当前位置、当前配置下的加速度（增删天体、重置后失效）
+    bool accelerationsValid_ = false;
+    unsigned long accelerationsRevision_ = 0;
+
+    // 增删天体时递增：下标与天体的对应关系、质量和半径只在它变化时改变
+    unsigned long layoutRevision_ = 0;
+
+public:
+    size_t size() const { return names_.size(); }
+    bool empty() const { return names_.empty(); }
+
+    void reserve(size_t n);
+    void add(const CelestialBody& body);
+    // 删除所有同名天体，保持其余天体的相对顺序，返回删除的个数。
+    // 没有该名称时不改动任何数组
+    size_t removeByName(const std::string& name);
+    void clear();
+
+    // 热数据数组
+    double* px() { return x_.data(); }
+    double* py() { return y_.data(); }
+    double* pz() { return z_.data(); }
+    double* vx() { return vx_.data(); }
+    double* vy() { return vy_.data(); }
+    double* vz() { return vz_.data(); }
+    double* ax() { return ax_.data(); }
+    double* ay() { return ay_.data(); }
+    double* az() { return az_.data(); }
+    const double* px() const { return x_.data(); }
+    const double* py() const { return y_.data(); }
+    const double* pz() const { return z_.data(); }
+    const double* vx() const { return vx_.data(); }
+    const double* vy() const { return vy_.data(); }
+    const double* vz() const { return vz_.data(); }
+    const double* ax() const { return ax_.data(); }
+    const double* ay() const { return ay_.data(); }
+    const double* az() const { return az_.data(); }
+    const double* mass() const { return mass_.data(); }
+    const double* radius() const { return radius_.data(); }
+
+    // 单个天体的访问（非热路径）
+    const std::string& name(size_t i) const { return names_[i]; }
+    // 名称对应的全部下标（升序），没有时返回nullptr。增删天体后失效
+    const std::vector<uint32_t>* indicesOf(const std::string& name) const;
+    Vector3D position(size_t i) const { return Vector3D(x_[i], y_[i], z_[i]); }
+    Vector3D velocity(size_t i) const { return Vector3D(vx_[i], vy_[i], vz_[i]); }
+    Vector3D acceleration(size_t i) const { return Vector3D(ax_[i], ay_[i], az_[i]); }
+
+    void setAcceleration(size_t i, const Vector3D& a) {
+        ax_[i] = a.x(); ay_[i] = a.y(); az_[i] = a.z();
+    }
+
+    // 清零所有速度和加速度
+    void resetMotion();
+
+    // 全部天体位置的轴对齐包围盒（并行归约），没有天体时返回false
+    bool bounds(Vector3D& lo, Vector3D& hi) const;
+
+    // KDK积分的前半部分：v += a * dt/2，x += v * dt，在一次遍历中完成。
+    // 后半步kick由下一次力计算在写出加速度时顺带完成（见VelocityKick）
+    void kickDrift(double dt);
+
+    // 后半步kick的参数：各速度数组加上 a * dt/2
+    VelocityKick closingKick(double dt) { return VelocityKick{ vx(), vy(), vz(), dt * 0.5 }; }
+
+    // 重新分配全部数组，由OpenMP线程按静态调度分块首次写入，
+    // 使每块数组位于之后处理它的线程所在的NUMA节点。增删天体后第一次调用时才生效
+    void placeForThreads();
+    nlohmann::json placementJson() const;
+
+    bool accelerationsValid(unsigned long configRevision) const {
+        return accelerationsValid_ && accelerationsRevision_ == configRevision;
+    }
+    void markAccelerationsValid(unsigned long configRevision) {
+        accelerationsValid_ = true;
+        accelerationsRevision_ = configRevision;
+    }
+
+    unsigned long layoutRevision() const { return layoutRevision_; }
+
+    // API边界：生成天体快照
+    std::shared_ptr<CelestialBody> makeBody(size_t i) const;
+    std::vector<std::shared_ptr<CelestialBody>> makeBodies() const;
+    nlohmann::json toJson() const;
+};
+
+} // namespace GEngine
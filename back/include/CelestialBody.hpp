@@ -35,16 +35,6 @@ public:
     void setVelocity(const Vector3D& vel) { velocity_ = vel; }
     void setAcceleration(const Vector3D& acc) { acceleration_ = acc; }
 
-    virtual void updateState(double dt) {
-        const auto& config = SimulationConfig::getInstance();
-        double effectiveTimeStep = config.timeDirectionForward ? dt : -dt;
-
-        Vector3D old_position = position_;
-        Vector3D half_velocity = velocity_ + acceleration_ * (effectiveTimeStep * 0.5);
-        position_ = position_ + half_velocity * effectiveTimeStep;
-        velocity_ = half_velocity + acceleration_ * (effectiveTimeStep * 0.5);
-    }
-
     virtual nlohmann::json toJson() const {
         return {
             {"name", name_},
@@ -14,32 +14,110 @@ public:
 
     // 模拟参数
     double timeStep = 864000.0;  // 默认时间步长（秒）
+    std::string integrator = "leapfrog";  // 时间积分器："leapfrog" | "yoshida4" | "rk45"
+    double integratorTolerance = 1e-9;  // rk45每步的相对误差容差
     double gravityConstant = 6.67430e-11;  // 万有引力常数
     double barnesHutTheta = 0.5;  // Barnes-Hut算法的精度参数
+    int leafCapacity = 8;  // Barnes-Hut树叶节点最多容纳的天体数，叶内天体直接求和
+    int treeGroupSize = 64;  // Barnes-Hut分组遍历：天体数不超过此值的子树共享一次遍历，0为逐天体遍历
+    int fmmOrder = 4;  // FMM的展开阶数（1-8）
+    double fmmTheta = 0.5;  // FMM的接受判据：(r_A + r_B) < fmmTheta * 质心距离
+    int fmmLeafCapacity = 32;  // FMM树叶节点最多容纳的天体数
+    std::string multipole = "monopole";  // Barnes-Hut节点的多极展开阶数："monopole" | "quadrupole"
+    std::string openingCriterion = "geometric";  // Barnes-Hut节点的接受判据："geometric" | "bmax" | "relative"
+    double targetForceError = 0.005;  // "relative"判据下代替barnesHutTheta：单个被接受节点的误差相对于天体加速度的上限
     double universeSize = 1e12;   // 宇宙大小（米）
+    bool dynamicTreeBox = true;  // Barnes-Hut树的根立方体按天体包围盒确定；false时固定为以原点为中心、半边长universeSize
+    double treeBoxPadding = 0.01;  // 根立方体在包围盒之外留出的余量（相对于半边长）
+    double treeBoxHysteresis = 0.5;  // 天体仍在上一步立方体内且包围盒不小于其该比例时沿用，0为每步重新确定
+    double treeRefitMaxOverlap = 0.25;  // 树refit允许的最大重叠度（节点边界相对格子的放大比例），超过时重建，0为每步重建
     bool timeDirectionForward = true;  // 时间方向（true为正向，false为逆向）
+    bool symmetricForces = false;  // 直接求和时每对天体只算一次（牛顿第三定律）
+    int directTileSize = 0;  // 直接求和的源天体分块大小：0按L1缓存自动确定，负数不分块
+    std::string forcePrecision = "double";  // 力计算精度："double" | "mixed" | "float"
+    std::string simdLevel = "auto";  // 力计算核函数的SIMD级别："auto" | "avx512" | "avx2" | "scalar"
+    std::string softening = "none";  // 软化律："none" | "plummer"
+    double softeningLength = 0.0;  // Plummer软化长度（米）
+    bool collisionExclusion = true;  // 距离不大于半径之和的天体对不计入引力
+    int dimensions = 3;  // 2时只在xy平面内计算引力
+    std::string threadAffinity = "none";  // OpenMP线程绑定："none" | "compact" | "scatter"
+    bool numaReplicas = true;  // 多NUMA节点时为每个节点复制一份只读的源天体数组
+
+    // 配置版本号：每次loadFromJson后递增，模拟器据此判断缓存的加速度是否需要重新计算
+    unsigned long revision() const { return revision_; }
 
     // 从JSON加载配置
     void loadFromJson(const nlohmann::json& config) {
+        ++revision_;
         if (config.contains("timeStep")) timeStep = config["timeStep"];
+        if (config.contains("integrator")) integrator = config["integrator"];
+        if (config.contains("integratorTolerance")) integratorTolerance = config["integratorTolerance"];
         if (config.contains("gravityConstant")) gravityConstant = config["gravityConstant"];
         if (config.contains("barnesHutTheta")) barnesHutTheta = config["barnesHutTheta"];
+        if (config.contains("leafCapacity")) leafCapacity = config["leafCapacity"];
+        if (config.contains("treeGroupSize")) treeGroupSize = config["treeGroupSize"];
+        if (config.contains("multipole")) multipole = config["multipole"];
+        if (config.contains("openingCriterion")) openingCriterion = config["openingCriterion"];
+        if (config.contains("targetForceError")) targetForceError = config["targetForceError"];
+        if (config.contains("fmmOrder")) fmmOrder = config["fmmOrder"];
+        if (config.contains("fmmTheta")) fmmTheta = config["fmmTheta"];
+        if (config.contains("fmmLeafCapacity")) fmmLeafCapacity = config["fmmLeafCapacity"];
         if (config.contains("universeSize")) universeSize = config["universeSize"];
+        if (config.contains("dynamicTreeBox")) dynamicTreeBox = config["dynamicTreeBox"];
+        if (config.contains("treeBoxPadding")) treeBoxPadding = config["treeBoxPadding"];
+        if (config.contains("treeBoxHysteresis")) treeBoxHysteresis = config["treeBoxHysteresis"];
+        if (config.contains("treeRefitMaxOverlap")) treeRefitMaxOverlap = config["treeRefitMaxOverlap"];
         if (config.contains("timeDirectionForward")) timeDirectionForward = config["timeDirectionForward"];
+        if (config.contains("symmetricForces")) symmetricForces = config["symmetricForces"];
+        if (config.contains("directTileSize")) directTileSize = config["directTileSize"];
+        if (config.contains("forcePrecision")) forcePrecision = config["forcePrecision"];
+        if (config.contains("simdLevel")) simdLevel = config["simdLevel"];
+        if (config.contains("softening")) softening = config["softening"];
+        if (config.contains("softeningLength")) softeningLength = config["softeningLength"];
+        if (config.contains("collisionExclusion")) collisionExclusion = config["collisionExclusion"];
+        if (config.contains("dimensions")) dimensions = config["dimensions"];
+        if (config.contains("threadAffinity")) threadAffinity = config["threadAffinity"];
+        if (config.contains("numaReplicas")) numaReplicas = config["numaReplicas"];
     }
 
     // 导出为JSON
     nlohmann::json toJson() const {
         return {
             {"timeStep", timeStep},
+            {"integrator", integrator},
+            {"integratorTolerance", integratorTolerance},
             {"gravityConstant", gravityConstant},
             {"barnesHutTheta", barnesHutTheta},
+            {"leafCapacity", leafCapacity},
+            {"treeGroupSize", treeGroupSize},
+            {"multipole", multipole},
+            {"openingCriterion", openingCriterion},
+            {"targetForceError", targetForceError},
+            {"fmmOrder", fmmOrder},
+            {"fmmTheta", fmmTheta},
+            {"fmmLeafCapacity", fmmLeafCapacity},
             {"universeSize", universeSize},
-            {"timeDirectionForward", timeDirectionForward}
+            {"dynamicTreeBox", dynamicTreeBox},
+            {"treeBoxPadding", treeBoxPadding},
+            {"treeBoxHysteresis", treeBoxHysteresis},
+            {"treeRefitMaxOverlap", treeRefitMaxOverlap},
+            {"timeDirectionForward", timeDirectionForward},
+            {"symmetricForces", symmetricForces},
+            {"directTileSize", directTileSize},
+            {"forcePrecision", forcePrecision},
+            {"simdLevel", simdLevel},
+            {"softening", softening},
+            {"softeningLength", softeningLength},
+            {"collisionExclusion", collisionExclusion},
+            {"dimensions", dimensions},
+            {"threadAffinity", threadAffinity},
+            {"numaReplicas", numaReplicas}
         };
     }
 
 private:
+    unsigned long revision_ = 0;
+
     SimulationConfig() = default;
     SimulationConfig(const SimulationConfig&) = delete;
     SimulationConfig& operator=(const SimulationConfig&) = delete;
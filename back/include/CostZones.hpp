@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <omp.h>
+#include <nlohmann/json.hpp>
+
+namespace GEngine {
+
+// 树遍历的负载均衡（costzones + 工作窃取）。
+// 每个天体的代价是上一步遍历中的相互作用数（接受的节点数与直接计算的天体数之和）。
+// 天体按树的Morton顺序排列后按累计代价等分给各线程，空间上相邻的天体落在同一线程，
+// 每个线程的区段再切成若干块；线程做完自己的块后从其他线程区段的尾部窃取。
+// 工作项为一组天体时，组的代价按天体数平摊回各天体，下次划分时重新求和，
+// 因此重新建树、组的划分改变后代价仍然有效。天体数变化后代价重置为均匀分布。
+class CostZones {
+public:
+    static constexpr int kChunksPerThread = 8;
+
+    // 并行处理order中的全部天体。work(k)计算order[k]并返回其相互作用数
+    template <class Work>
+    void run(const uint32_t* order, size_t n, Work&& work) { run(order, nullptr, n, work); }
+
+    // 工作项k为天体 order[itemStart[k]] .. order[itemStart[k + 1] - 1]，itemStart共items + 1项。
+    // work(k)处理整组并返回其相互作用数
+    template <class Work>
+    void run(const uint32_t* order, const uint32_t* itemStart, size_t items, Work&& work);
+
+    nlohmann::json toJson() const;
+
+private:
+    // 一个线程剩余的块区间[front, back)，打包在一个64位原子量中：
+    // 所有者从front取块，窃取者从back取块
+    struct alignas(64) Queue {
+        std::atomic<uint64_t> range{0};
+        uint64_t cost = 0;  // 本步该线程实际完成的代价
+        uint32_t steals = 0;
+    };
+
+    std::vector<uint32_t> cost_;        // 按天体下标，上一步的相互作用数
+    std::vector<uint32_t> chunkStart_;  // 各块的起始工作项，最后一项为工作项数
+    std::vector<uint64_t> itemCost_;    // 本次划分中各工作项的代价
+    std::vector<Queue> queues_;
+
+    // 上一步的统计
+    uint64_t totalCost_ = 0;
+    uint64_t maxThreadCost_ = 0;
+    uint64_t steals_ = 0;
+    int threads_ = 0;
+
+    // 按代价把工作项切成threads * kChunksPerThread块，并把块平均分给各线程
+    void partition(const uint32_t* order, const uint32_t* itemStart, size_t items, int threads);
+    // 工作项k的代价：其中各天体代价之和
+    uint64_t itemCost(const uint32_t* order, const uint32_t* itemStart, size_t k) const;
+    void collectStats();
+
+    static uint64_t pack(uint32_t front, uint32_t back) { return (uint64_t(back) << 32) | front; }
+    static bool popFront(Queue& q, uint32_t& chunk);
+    static bool popBack(Queue& q, uint32_t& chunk);
+};
+
+template <class Work>
+void CostZones::run(const uint32_t* order, const uint32_t* itemStart, size_t items, Work&& work) {
+    if (items == 0) return;
+    const size_t bodies = itemStart ? itemStart[items] : items;
+    if (cost_.size() != bodies) cost_.assign(bodies, 1);
+
+    const int threads = omp_get_max_threads();
+    if (static_cast<int>(queues_.size()) < threads) queues_ = std::vector<Queue>(threads);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        #pragma omp single
+        partition(order, itemStart, items, omp_get_num_threads());
+
+        const int t = omp_get_thread_num();
+        const int used = omp_get_num_threads();
+        auto process = [&](uint32_t chunk) {
+            uint64_t done = 0;
+            for (uint32_t k = chunkStart_[chunk], end = chunkStart_[chunk + 1]; k < end; ++k) {
+                const uint32_t interactions = work(k);
+                const uint32_t first = itemStart ? itemStart[k] : k;
+                const uint32_t last = itemStart ? itemStart[k + 1] : k + 1;
+                const uint32_t share = interactions / (last - first);
+                for (uint32_t s = first; s < last; ++s) cost_[order[s]] = share > 0 ? share : 1;
+                done += interactions;
+            }
+            queues_[t].cost += done;
+        };
+
+        uint32_t chunk;
+        while (popFront(queues_[t], chunk)) process(chunk);
+        // 自己的块做完后依次从其他线程窃取
+        for (int k = 1; k < used; ++k) {
+            Queue& victim = queues_[(t + k) % used];
+            while (popBack(victim, chunk)) {
+                ++queues_[t].steals;
+                process(chunk);
+            }
+        }
+    }
+    collectStats();
+}
+
+} // namespace GEngine
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ISimulator.hpp"
+#include "LinearOctree.hpp"
+#include "FmmSolver.hpp"
+#include "BodyStore.hpp"
+#include "Integrator.hpp"
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace GEngine {
+
+// 快速多极子方法模拟器：与Barnes-Hut共用线性八叉树和根立方体，力计算为O(N)的FMM。
+// 展开阶数、接受判据和叶节点容量由 fmmOrder / fmmTheta / fmmLeafCapacity 配置
+class FmmSimulator : public ISimulator {
+private:
+    BodyStore bodies_;
+    LinearOctree tree_;
+    RootCube rootCube_;
+    FmmSolver solver_;
+    std::unique_ptr<IIntegrator> integrator_;  // 按配置选择，跨步保留（rk45的子步长）
+    std::vector<nlohmann::json> eventLog; // 存储事件
+    std::vector<std::pair<uint32_t, uint32_t>> contacts_;  // 碰撞查询的结果，跨步复用
+    // step()在原地重建树和多极矩：天体状态、事件、引力场查询和诊断与step()、增删天体互斥
+    mutable std::mutex mutex_;
+
+    // 在当前位置建树并计算加速度；kick非空时同时做后半步kick
+    void computeForces(const VelocityKick* kick);
+    // 增删天体后树和多极矩失效
+    void invalidateTree();
+    // 单点引力场，调用方持有mutex_
+    Vector3D fieldAt(const Vector3D& position) const;
+
+public:
+    // 基本操作
+    void addBody(std::shared_ptr<CelestialBody> body) override;
+    void removeBody(const std::string& name) override;
+    void clear() override;
+
+    // 模拟控制
+    void step() override;
+    void reset() override;
+
+    // 状态访问
+    nlohmann::json getSystemState() const override;
+    std::vector<std::shared_ptr<CelestialBody>> getBodies() const override;
+
+    // 配置
+    void configure(const nlohmann::json& config) override;
+
+    nlohmann::json getDiagnostics() const override;
+
+    // 用上一步的多极矩计算引力场；还没有多极矩时（首步之前、增删天体之后）直接求和。
+    // 与step()互斥，step()进行中时等它完成
+    Vector3D calculateGravitationalField(const Vector3D& position) const override;
+    void calculateGravitationalFields(const Vector3D* positions, Vector3D* fields, size_t n) const override;
+
+    //碰撞检测：在本步建好的树上查找接触的天体对，事件按 (i, j) 升序记录
+    void detectCollisions();
+
+    std::vector<nlohmann::json> getEvents() override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto temp = eventLog;
+            eventLog.clear();
+            return temp;
+    }
+};
+
+} // namespace GEngine
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Vector3D.hpp"
+#include "BodyStore.hpp"
+#include "ForceKernels.hpp"
+#include "LinearOctree.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace GEngine {
+
+// 快速多极子方法（FMM）的参数，每步从配置读取一次
+struct FmmParams {
+    int order;               // 展开阶数p：多极矩和局部展开保留到p阶
+    double theta;            // 接受判据：(r_A + r_B) < theta * |c_A - c_B|
+    double gravityConstant;
+    double softening2;       // 只用于叶节点之间的直接求和
+};
+
+// 在LinearOctree上做笛卡尔展开的FMM。
+// 多极矩和局部展开以节点质心为中心，按多重指标 k = (kx, ky, kz), |k| <= p 存放：
+//   M_k = sum m (x - c)^k / k!                       （P2M，M2M按二项式平移）
+//   L_n = sum_k (-1)^|k| M_k D^(k+n)(1/r)(R) / n!     （M2L，|k| + |n| <= p）
+// 其中 D^n(1/r) 由递推 |n| r^2 D^n = -(2|n|-1) sum_i n_i x_i D^(n-e_i) - (|n|-1) sum_i n_i (n_i-1) D^(n-2e_i) 求出。
+// 双树遍历以目标节点为单位进行：每个节点带着候选源节点列表访问一次，满足判据的做M2L，
+// 两个叶节点之间直接求和，否则把较大的一方细分；不能在本节点处理的源节点留给子节点。
+// 每个节点只被一个任务访问，写入互不冲突，子节点按OpenMP任务并行。
+class FmmSolver {
+public:
+    static constexpr int kMaxOrder = 8;
+
+    // 计算全部天体的加速度并写入store，kick非空时同时做速度kick。
+    // tree必须已在store的当前位置上建好
+    void computeAccelerations(BodyStore& store, const LinearOctree& tree, const FmmParams& params,
+                              const KernelPolicy& policy, const VelocityKick* kick = nullptr);
+
+    // 用最近一次computeAccelerations得到的多极矩计算任意点的引力场（M2P，近处节点直接求和）。
+    // 没有可用的多极矩时返回false
+    bool fieldAt(const LinearOctree& tree, const Vector3D& position, Vector3D& field) const;
+
+    void clear() { nodes_ = 0; }
+
+    nlohmann::json toJson() const;
+
+private:
+    // 多重指标表：按总阶数排列的 |k| <= order 的全部指标
+    struct Terms {
+        int order = -1;
+        std::vector<std::array<uint8_t, 3>> index;
+        std::vector<double> invFactorial;  // 1 / k!
+        std::vector<int> lookup;           // (kx, ky, kz) -> 下标，kx/ky/kz各占 order+2 档
+        // 平移（M2M、L2L）用到的指标对：k >= l（逐分量），k - l 的下标
+        struct Shift { uint32_t k, l, diff; double l2l; };  // l2l = k! / l!
+        std::vector<Shift> shifts;
+        // M2L：L_n += sum_k (-1)^|k| M_k D_(k+n) / n!。指标按阶数排列，|k| <= p - |n| 的k恰为前m2lCount[n]个，
+        // k + n 的下标存放在 m2lIndex[m2lStart[n] + k]
+        std::vector<double> sign;  // (-1)^|k|
+        std::vector<uint32_t> m2lStart, m2lCount, m2lIndex;
+        // D^n(1/r)递推的系数：D_n = (sum_i first[i] * r_i * D_(n-e_i) + sum_i second[i] * D_(n-2e_i)) / r^2，
+        // 不存在的项系数为0、下标为0
+        struct Recurrence { uint32_t first[3], second[3]; double firstCoef[3], secondCoef[3]; };
+        std::vector<Recurrence> recurrence;
+        size_t size() const { return index.size(); }
+        int at(int x, int y, int z) const { return lookup[(x * (order + 2) + y) * (order + 2) + z]; }
+        void build(int p);
+    };
+
+    Terms terms_;        // 展开阶数p的指标
+    Terms derivTerms_;   // p+1阶：场计算（M2P求梯度）需要高一阶的导数
+
+    FmmParams params_{};
+    size_t nodes_ = 0;
+    std::vector<double> multipole_;  // 节点 * terms
+    std::vector<double> local_;
+    std::vector<double> radius_;     // 节点内天体到质心的最大距离
+    AlignedVector<double> accX_, accY_, accZ_;  // 按排序后顺序的近场加速度
+    std::vector<std::vector<uint32_t>> pending_;  // 各线程处理候选源节点用的栈，跨步复用
+
+    // 上一次计算的统计
+    size_t m2lCount_ = 0;
+    size_t p2pPairs_ = 0;
+
+    void upwardPass(const LinearOctree& tree);
+    // 以target为目标节点处理候选源节点，留下的源节点交给子节点（见类注释）
+    void interact(const LinearOctree& tree, uint32_t target, const std::vector<uint32_t>& candidates,
+                  const KernelSet& kernels);
+    void downwardPass(const LinearOctree& tree);
+};
+
+} // namespace GEngine
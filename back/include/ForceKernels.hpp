@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace GEngine {
+
+// 直接求和核函数的输入输出（指向BodyStore中的SoA数组）
+struct DirectSumArgs {
+    const double* x;
+    const double* y;
+    const double* z;
+    const double* mass;
+    const double* radius;
+    double* ax;
+    double* ay;
+    double* az;
+    double gravityConstant;
+    double softening2 = 0.0;  // 软化长度的平方（Plummer软化时使用）
+};
+
+// 树节点四极项的输入：节点质心与关于质心的无迹四极矩（SoA）
+struct QuadrupoleArgs {
+    const double* x;
+    const double* y;
+    const double* z;
+    const double* xx;
+    const double* xy;
+    const double* xz;
+    const double* yy;
+    const double* yz;
+    const double* zz;
+    double gravityConstant;
+};
+
+// 单精度相互作用的源天体：坐标已减去局部原点，gm为 G*质量。
+// xlo/ylo/zlo非空时坐标以两个float之和表示（x + xlo），
+// 相近天体的位移可以精确到单精度相对于间距的舍入，而不是相对于到原点的距离。
+struct FloatSources {
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* gm;
+    const float* radius;
+    size_t count;
+    const float* xlo = nullptr;
+    const float* ylo = nullptr;
+    const float* zlo = nullptr;
+    float softening2 = 0.0f;
+};
+
+// 单精度相互作用的目标天体：坐标与源天体使用同一原点和表示，结果以双精度累加到ax/ay/az
+struct FloatTargets {
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* radius;
+    size_t count;
+    double* ax;
+    double* ay;
+    double* az;
+    const float* xlo = nullptr;
+    const float* ylo = nullptr;
+    const float* zlo = nullptr;
+};
+
+// 力计算的收尾：目标天体的加速度一旦算完，立即在同一遍历中做半步kick（v += a * dt），
+// 不再为积分单独扫一遍内存
+struct VelocityKick {
+    double* vx;
+    double* vy;
+    double* vz;
+    double dt;
+
+    void apply(size_t i, double ax, double ay, double az) const {
+        vx[i] += ax * dt;
+        vy[i] += ay * dt;
+        vz[i] += az * dt;
+    }
+};
+
+enum class SimdLevel { Scalar, AVX2, AVX512 };
+
+// 力计算精度策略（SimulationConfig::forcePrecision）：
+//   Double - 全部双精度
+//   Mixed  - 相互作用用单精度，坐标先平移到局部原点（包围盒中心或树节点）再转换为两个float之和，
+//            累加和状态保持双精度
+//   Float  - 相互作用用单精度，坐标直接转换（不平移），只适合小尺度或预览
+enum class ForcePrecision { Double, Mixed, Float };
+
+// 软化律（SimulationConfig::softening）：None为纯牛顿引力，Plummer为 r / (r^2 + eps^2)^(3/2)
+enum class SofteningLaw { None, Plummer };
+
+// 核函数的编译期策略组合。运行时每步由配置确定一次，
+// 据此从分派表中取出完全特化、内层循环无分支的核函数。
+struct KernelPolicy {
+    SofteningLaw softening = SofteningLaw::None;
+    bool collisionExclusion = true;  // 距离不大于半径之和的天体对不计入
+    int dimensions = 3;              // 2时忽略z分量
+};
+
+using DirectSumFn = void (*)(const DirectSumArgs&, size_t i0, size_t i1, size_t j0, size_t j1);
+using DirectSumFloatFn = void (*)(const FloatSources&, const FloatTargets&);
+using SymmetricRowsFn = void (*)(const DirectSumArgs&, size_t i0, size_t i1, size_t n);
+using LeafSumFn = void (*)(const DirectSumArgs&, size_t j0, size_t j1,
+                           double xi, double yi, double zi, double ri, double* acc);
+using QuadrupoleSumFn = void (*)(const QuadrupoleArgs&, size_t j0, size_t j1,
+                                 double xi, double yi, double zi, double* acc);
+
+// 按某一SIMD级别和策略特化好的一组核函数
+struct KernelSet {
+    // 将源天体[j0, j1)对目标天体[i0, i1)产生的引力加速度累加到ax/ay/az。
+    // 各SIMD实现与标量实现只在求和顺序和FMA舍入上不同：
+    // 每个加速度分量的偏差不超过 1e-12 * sum_j |a_ij|（各项绝对值之和）。
+    DirectSumFn directSum;
+    // 单精度直接求和（Float精度）：每个目标的贡献先在单精度中求和，再加到双精度结果上
+    DirectSumFloatFn directSumFloat;
+    // 同上，坐标为 hi + lo 两个float之和（Mixed精度）
+    DirectSumFloatFn directSumSplit;
+    // 对称求和：对 i in [i0, i1) 只计算 j in (i, n) 的天体对，
+    // 把贡献加到 ax[i]、把等大反向的贡献减到 ax[j]。输出通常是线程私有缓冲区，由调用方归约。
+    SymmetricRowsFn symmetricRows;
+    // 单个目标（坐标xi/yi/zi、半径ri）对源天体[j0, j1)的加速度累加到acc[0..2]，不写ax/ay/az。
+    // 用于树的叶节点：目标自身在范围内时距离为0，由策略的掩码排除
+    LeafSumFn leafSum;
+    // 单个目标对节点[j0, j1)的四极项加速度累加到acc[0..2]（不做软化，只用于被接受的远处节点）
+    QuadrupoleSumFn quadrupoleSum;
+};
+
+namespace ForceKernels {
+
+// 当前CPU（及操作系统）支持的最高SIMD级别
+SimdLevel detectSimdLevel();
+
+// 实际使用的SIMD级别：由SimulationConfig::simdLevel指定，但不超过detectSimdLevel()
+SimdLevel activeSimdLevel();
+
+const char* simdLevelName(SimdLevel level);
+SimdLevel parseSimdLevel(const std::string& name);
+
+ForcePrecision activePrecision();
+const char* precisionName(ForcePrecision precision);
+ForcePrecision parsePrecision(const std::string& name);
+
+// 由SimulationConfig得到的策略组合
+KernelPolicy activePolicy();
+SofteningLaw parseSoftening(const std::string& name);
+
+// 分派表查询：每步调用一次，之后只通过返回的函数指针调用核函数
+const KernelSet& selectKernels(SimdLevel level, const KernelPolicy& policy);
+
+// 对全部n个天体直接求和并覆盖写入ax/ay/az，按目标块在OpenMP线程间并行。
+// sourceTile > 0 时再把源天体切成大小为sourceTile的块：一个源块在L1中驻留，
+// 被目标块内所有天体依次复用后才换入下一块；sourceTile == 0 时每个目标天体扫过全部源天体。
+// precision不为Double时，坐标先整体转换为单精度再调用单精度核函数。
+// kick非空时每个目标块算完后立即对该块做速度kick。
+// nodeArgs非空时（每个NUMA节点一项，源天体指向该节点的副本），双精度路径中每个线程读取本节点的副本。
+void directSumAll(const KernelSet& kernels, ForcePrecision precision,
+                  const DirectSumArgs& args, size_t n, size_t sourceTile,
+                  const VelocityKick* kick = nullptr,
+                  const std::vector<DirectSumArgs>* nodeArgs = nullptr);
+
+// 按L1数据缓存容量估计的源块大小（一半L1用于源天体的x/y/z/质量/半径）
+size_t autoSourceTile();
+
+} // namespace ForceKernels
+
+} // namespace GEngine
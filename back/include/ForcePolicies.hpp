@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ForceKernels.hpp"
+#include <cstddef>
+
+namespace GEngine {
+
+// 力计算核函数的编译期策略。V为SIMD寄存器封装（见src/kernels/SimdTypes.hpp），
+// 标量代码使用宽度为1的封装，与SIMD核函数共用同一套策略。
+
+struct NoSoftening {
+    static constexpr SofteningLaw law = SofteningLaw::None;
+    template <class V>
+    static typename V::reg apply(typename V::reg d2, typename V::reg) { return d2; }
+};
+
+struct PlummerSoftening {
+    static constexpr SofteningLaw law = SofteningLaw::Plummer;
+    template <class V>
+    static typename V::reg apply(typename V::reg d2, typename V::reg eps2) { return V::add(d2, eps2); }
+};
+
+template <class Softening, bool CollisionExclusion, int Dimensions>
+struct ForcePolicy {
+    using softening = Softening;
+    static constexpr bool collisionExclusion = CollisionExclusion;
+    static constexpr int dimensions = Dimensions;
+
+    // 天体对是否计入：开启碰撞排除时要求距离大于半径之和，否则只排除重合（含自身）的天体对
+    template <class V>
+    static typename V::reg mask(typename V::reg d2, typename V::reg radiusSum, typename V::reg value) {
+        if constexpr (CollisionExclusion) {
+            return V::selectGreater(d2, V::mul(radiusSum, radiusSum), value);
+        } else {
+            return V::selectGreater(d2, V::zero(), value);
+        }
+    }
+};
+
+constexpr size_t kPolicyCount = 8;
+
+inline size_t policyIndex(const KernelPolicy& p) {
+    return (p.softening == SofteningLaw::Plummer ? 4 : 0)
+         + (p.collisionExclusion ? 2 : 0)
+         + (p.dimensions == 2 ? 1 : 0);
+}
+
+template <class P>
+constexpr size_t policyIndex() {
+    return (P::softening::law == SofteningLaw::Plummer ? 4 : 0)
+         + (P::collisionExclusion ? 2 : 0)
+         + (P::dimensions == 2 ? 1 : 0);
+}
+
+// 对全部策略组合各调用一次 f(ForcePolicy<...>{})，用于实例化分派表
+template <class F>
+void forEachPolicy(F&& f) {
+    f(ForcePolicy<NoSoftening, false, 3>{});
+    f(ForcePolicy<NoSoftening, false, 2>{});
+    f(ForcePolicy<NoSoftening, true, 3>{});
+    f(ForcePolicy<NoSoftening, true, 2>{});
+    f(ForcePolicy<PlummerSoftening, false, 3>{});
+    f(ForcePolicy<PlummerSoftening, false, 2>{});
+    f(ForcePolicy<PlummerSoftening, true, 3>{});
+    f(ForcePolicy<PlummerSoftening, true, 2>{});
+}
+
+// 按运行时策略调用一次 f(ForcePolicy<...>{})
+template <class F>
+void withPolicy(const KernelPolicy& policy, F&& f) {
+    const size_t index = policyIndex(policy);
+    forEachPolicy([&](auto p) {
+        if (policyIndex<decltype(p)>() == index) f(p);
+    });
+}
+
+} // namespace GEngine
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace GEngine {
+
+// 运行时查询的硬件参数
+namespace Hardware {
+
+// 每核L1数据缓存和L2缓存的字节数，无法查询时返回常见的默认值
+size_t l1DataCacheSize();
+size_t l2CacheSize();
+
+// NUMA节点：内核的节点编号及节点上的逻辑CPU编号
+struct NumaNode {
+    int id;
+    std::vector<int> cpus;
+};
+
+// NUMA拓扑：在线且有CPU的节点，按编号升序，编号可以不连续（如只有node0和node2）。
+// 无法查询时视为单个节点0，包含全部CPU。
+// 各节点的副本、线程所在节点等按节点在此列表中的下标索引，对外报告时用id
+const std::vector<NumaNode>& numaNodes();
+
+// 逻辑CPU所在的NUMA节点在numaNodes()中的下标，未知时返回0
+int numaNodeOfCpu(int cpu);
+
+// 调用线程当前运行所在的NUMA节点在numaNodes()中的下标
+int currentNumaNode();
+
+} // namespace Hardware
+
+} // namespace GEngine
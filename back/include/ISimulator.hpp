@@ -15,6 +15,11 @@ public:
     virtual void addBody(std::shared_ptr<CelestialBody> body) = 0;
     virtual void removeBody(const std::string& name) = 0;
     virtual void clear() = 0;
+
+    // 批量添加天体（导入配置时使用）
+    virtual void addBodies(const std::vector<std::shared_ptr<CelestialBody>>& bodies) {
+        for (const auto& body : bodies) addBody(body);
+    }
     
     // 模拟控制
     virtual void step() = 0;
@@ -29,6 +34,13 @@ public:
 
     // 引力场计算
     virtual Vector3D calculateGravitationalField(const Vector3D& position) const = 0;
+
+    // 批量计算引力场：fields[i] 为 positions[i] 处的引力场
+    virtual void calculateGravitationalFields(const Vector3D* positions, Vector3D* fields, size_t n) const {
+        for (size_t i = 0; i < n; ++i) {
+            fields[i] = calculateGravitationalField(positions[i]);
+        }
+    }
     
     // 获取引力场数据
     virtual nlohmann::json getGravitationalFieldData(
@@ -38,34 +50,44 @@ public:
     ) const {
         nlohmann::json fieldData = nlohmann::json::array();
         double step = size / resolution;
-        
+
+        // 先生成全部网格点，再整批计算引力场和模长
+        std::vector<Vector3D> positions;
+        positions.reserve(static_cast<size_t>(resolution) * resolution * resolution);
         for (int x = 0; x < resolution; ++x) {
             for (int y = 0; y < resolution; ++y) {
                 for (int z = 0; z < resolution; ++z) {
-                    Vector3D pos(
+                    positions.emplace_back(
                         center.x() + (x - resolution/2) * step,
                         center.y() + (y - resolution/2) * step,
                         center.z() + (z - resolution/2) * step
                     );
-                    
-                    Vector3D field = calculateGravitationalField(pos);
-                    double magnitude = field.magnitude();
-                    
-                    if (magnitude > 1e-10) {  // 只记录有意义的数据点
-                        fieldData.push_back({
-                            {"position", pos.toJson()},
-                            {"field", field.toJson()},
-                            {"magnitude", magnitude}
-                        });
-                    }
                 }
             }
         }
+
+        std::vector<Vector3D> fields(positions.size());
+        std::vector<double> magnitudes(positions.size());
+        calculateGravitationalFields(positions.data(), fields.data(), positions.size());
+        Vector3D::magnitudes(fields.data(), magnitudes.data(), fields.size());
+
+        for (size_t i = 0; i < positions.size(); ++i) {
+            if (magnitudes[i] > 1e-10) {  // 只记录有意义的数据点
+                fieldData.push_back({
+                    {"position", positions[i].toJson()},
+                    {"field", fields[i].toJson()},
+                    {"magnitude", magnitudes[i]}
+                });
+            }
+        }
         
         return fieldData;
     }
 
     virtual std::vector<nlohmann::json> getEvents() = 0;
+
+    // 运行时诊断信息（数据放置等），默认为空对象
+    virtual nlohmann::json getDiagnostics() const { return nlohmann::json::object(); }
 };
 
 } // namespace GEngine 
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "BodyStore.hpp"
+#include "ForceKernels.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace GEngine {
+
+// 力计算：在store的当前位置求出加速度写入store，kick非空时写出的同时做速度kick
+using ForceFunction = std::function<void(const VelocityKick* kick)>;
+
+// 时间积分器，直接在BodyStore的SoA数组上推进。
+// 进入step()时store的加速度必须对应当前位置，返回时同样对应新位置（下一步和碰撞检测直接使用）
+class IIntegrator {
+public:
+    virtual ~IIntegrator() = default;
+
+    // 把全部天体推进dt（逆向积分时为负）
+    virtual void step(BodyStore& store, double dt, const ForceFunction& forces) = 0;
+
+    // 配置中的名称（SimulationConfig::integrator）
+    virtual const char* name() const = 0;
+
+    // 最近一步的统计
+    virtual nlohmann::json toJson() const;
+
+protected:
+    size_t forceEvaluations_ = 0;  // 最近一步的力计算次数
+};
+
+// 二阶蛙跳（KDK）：每步一次力计算，辛积分，能量误差有界
+class LeapfrogIntegrator : public IIntegrator {
+public:
+    void step(BodyStore& store, double dt, const ForceFunction& forces) override;
+    const char* name() const override { return "leapfrog"; }
+};
+
+// 四阶Yoshida辛积分：以 w1, w0, w1 为系数连续做三次KDK，w1 = 1 / (2 - 2^(1/3))，w0 = 1 - 2 w1。
+// 每步三次力计算；中间一步为逆向，误差随步长四次方减小
+class Yoshida4Integrator : public IIntegrator {
+public:
+    void step(BodyStore& store, double dt, const ForceFunction& forces) override;
+    const char* name() const override { return "yoshida4"; }
+};
+
+// Dormand-Prince 5(4) 自适应Runge-Kutta：在dt内按误差估计自动分成若干子步，
+// 误差范数为各分量误差相对于 tolerance * (|y| + 同类分量的均方根) 的均方根，不超过1时接受。
+// 最后一级在新位置上求力，接受后直接作为下一子步的第一级（FSAL），每个被接受的子步六次力计算。
+// 子步长跨步保留，天体增删后重新从dt开始。不是辛积分，长时间积分的能量会漂移
+class Rk45Integrator : public IIntegrator {
+public:
+    explicit Rk45Integrator(double tolerance) : tolerance_(tolerance) {}
+
+    void step(BodyStore& store, double dt, const ForceFunction& forces) override;
+    const char* name() const override { return "rk45"; }
+    nlohmann::json toJson() const override;
+
+    void setTolerance(double tolerance) { tolerance_ = tolerance; }
+
+private:
+    static constexpr int kStages = 7;
+    static constexpr size_t kMaxSubsteps = 1000000;
+
+    double tolerance_;
+    double stepSize_ = 0;          // 上一个被接受子步之后建议的步长（绝对值），0表示从dt开始
+    unsigned long layout_ = 0;     // stepSize_对应的天体布局（BodyStore::layoutRevision）
+    size_t substeps_ = 0;          // 最近一步接受的子步数
+    size_t rejected_ = 0;          // 最近一步拒绝的子步数
+
+    // 状态和各级导数，按分量连续存放：[x, y, z, vx, vy, vz]，每个分量n个
+    std::vector<double> start_, result_;
+    std::vector<double> stages_[kStages];
+
+    // 把 start_ + h * sum(coef[j] * stages_[j]) 写入store的位置和速度
+    void writeStage(BodyStore& store, double h, const double* coef, int count);
+    // 读出store当前的速度和加速度作为第s级导数
+    void readDerivative(const BodyStore& store, int s);
+};
+
+namespace Integrators {
+
+// 按名称创建积分器："leapfrog" | "yoshida4" | "rk45"，其他名称按leapfrog
+std::unique_ptr<IIntegrator> create(const std::string& name, double tolerance);
+
+// current与配置的积分器不同（或为空）时重新创建，相同时保留其跨步状态并更新容差
+void select(std::unique_ptr<IIntegrator>& current, const std::string& name, double tolerance);
+
+} // namespace Integrators
+
+} // namespace GEngine
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "Vector3D.hpp"
+#include "BodyStore.hpp"
+#include "ForceKernels.hpp"
+#include "CostZones.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace GEngine {
+
+// 节点的接受判据：满足时用节点的质心（及四极矩）代替其中的天体，否则打开节点
+enum class OpeningCriterion {
+    Geometric,  // halfSize < theta * d，d为节点质心到目标的距离
+    BMax,       // bmax < theta * d，bmax为节点内天体到质心的最大距离（上界），质心偏向节点一角时更保守
+    Relative    // 截断误差 G M l^2 / d^4（四极矩时 G M l^3 / d^5，l为节点边长）不超过 errorTolerance * |a|，
+                // |a|为目标上一步的加速度；另要求目标在节点边界放大1.2倍的范围之外
+};
+
+// 树上力计算的参数，每步从配置读取一次
+struct TreeForceParams {
+    double theta;            // 张角阈值
+    double gravityConstant;
+    double softening2;       // 软化长度的平方
+    OpeningCriterion criterion = OpeningCriterion::Geometric;
+    double errorTolerance = 0;  // Relative判据允许的单个节点的相对误差
+};
+
+// 建树参数，每步从配置读取一次
+struct TreeBuildParams {
+    size_t leafCapacity = 1;  // 天体数不超过此值的节点不再细分
+    bool quadrupole = false;  // 节点是否计算四极矩，力计算中对被接受的节点加上四极项
+    size_t groupSize = 0;     // 天体数不超过此值的最大子树作为一组共享一次遍历，0或1为逐天体遍历
+};
+
+// 树的内存占用。节点数组是按步复用的arena，high-water记录运行以来的最大值，用于估算大规模运行所需内存
+struct TreeMemoryStats {
+    size_t nodes = 0;           // 本步节点数
+    size_t nodeCapacity = 0;    // arena当前可容纳的节点数
+    size_t bytesInUse = 0;      // 本步节点及天体排序数组实际使用的字节数
+    size_t bytesReserved = 0;   // 已分配的字节数
+    size_t highWaterNodes = 0;
+    size_t highWaterBytes = 0;  // bytesInUse的最大值
+    size_t growths = 0;         // arena容量不足而重新分配的次数
+
+    nlohmann::json toJson() const {
+        return {
+            {"nodes", nodes},
+            {"nodeCapacity", nodeCapacity},
+            {"bytesInUse", bytesInUse},
+            {"bytesReserved", bytesReserved},
+            {"highWaterNodes", highWaterNodes},
+            {"highWaterBytes", highWaterBytes},
+            {"growths", growths}
+        };
+    }
+};
+
+// 树的更新统计。refit保持拓扑，天体越出所在叶节点的格子时不移动，而是放大包含它的各级节点的边界；
+// 重叠度为节点边界半边长相对格子半边长的最大放大比例（节点之间的重叠随之增加），超过阈值时重建
+struct TreeUpdateStats {
+    size_t rebuilds = 0;
+    size_t refits = 0;
+    size_t crossed = 0;   // 最近一次更新时不在所在叶节点格子内的天体数
+    double overlap = 0;   // 最近一次更新后的重叠度，重建后为0
+
+    nlohmann::json toJson() const {
+        return {
+            {"rebuilds", rebuilds},
+            {"refits", refits},
+            {"crossed", crossed},
+            {"overlap", overlap}
+        };
+    }
+};
+
+// 树的根立方体，每步按天体的包围盒确定。
+// 包围盒的最长边加上padding（相对于半边长）作为立方体边长；hysteresis > 0 时，
+// 只要全部天体仍在上一步的立方体内且包围盒不小于其hysteresis倍，就沿用上一步的立方体
+struct RootCube {
+    Vector3D center;
+    double halfSize = 0;
+    bool valid = false;
+    size_t refits = 0;  // 重新确定立方体的次数
+
+    void update(const BodyStore& store, double padding, double hysteresis);
+    void invalidate() { valid = false; }
+    nlohmann::json toJson() const;
+};
+
+// 按Morton键排序构建的线性八叉树。
+// 节点存放在连续数组中（结构体数组形式），子节点连续排列，父节点通过firstChild/childCount引用；
+// 叶节点引用排序后天体数组中的一段，叶内天体的位置、质量、半径连续存放，由SIMD核函数直接求和。节点按层（广度优先）排列，同一节点的子节点连续。
+// 建树的各阶段（Morton键、基数排序、逐层生成节点、自底向上求质心）都按OpenMP并行，
+// 生成的树与线程数无关。遍历使用固定大小的栈，不访问堆。
+// 节点数组是arena：每步重建时只把节点数归零，容量按上一步的节点数预留，不释放也不逐个分配。
+// 天体每步只移动格子的一小部分时，update()保持拓扑只做refit，见TreeUpdateStats。
+// 分组遍历时每组只遍历一次：判据用节点质心到组包围盒的最近距离，对组内每个天体都成立，
+// 得到的交互表（被接受的节点、打开的叶节点中的天体）由SIMD核函数对组内全部天体求和。
+class LinearOctree {
+public:
+    static constexpr uint32_t kNoChild = 0;  // 根节点下标为0，不会作为子节点
+    static constexpr int kMaxDepth = 21;     // 与Morton键每轴位数一致
+
+    // 以center为中心、半边长halfSize的立方体为根建树
+    void build(const BodyStore& store, const Vector3D& center, double halfSize,
+               const TreeBuildParams& params = TreeBuildParams{});
+    // 按store的当前位置更新树：拓扑仍然可用时refit，否则重建。天体增删（见BodyStore::layoutRevision）、
+    // 根立方体或建树参数变化，以及refit后重叠度超过maxOverlap时重建；maxOverlap <= 0 时每次都重建
+    void update(const BodyStore& store, const Vector3D& center, double halfSize,
+                const TreeBuildParams& params, double maxOverlap);
+    // 清空树但保留arena内存
+    void clear();
+
+    bool empty() const { return nodeCount_ == 0; }
+    size_t nodeCount() const { return nodeCount_; }
+    // 最深叶节点所在的层数（根为0层）
+    int depth() const { return levelStart_.size() > 1 ? static_cast<int>(levelStart_.size()) - 2 : 0; }
+    const TreeMemoryStats& memoryStats() const { return stats_; }
+    const TreeUpdateStats& updateStats() const { return updateStats_; }
+
+    // 并行计算全部天体的加速度并写入store，kick非空时同时做速度kick。精度和策略在进入遍历前分派一次。
+    // zones非空时按其记录的上一步代价划分负载并记录本步代价，否则按动态调度。
+    // Relative判据读取store中的加速度作为上一步的|a|（由调用方保证有效），|a|为0的目标按几何判据
+    void computeAccelerations(BodyStore& store, const TreeForceParams& params,
+                              ForcePrecision precision, const KernelPolicy& policy,
+                              const VelocityKick* kick = nullptr, CostZones* zones = nullptr) const;
+
+    size_t groupCount() const { return groups_.size(); }
+
+    // position处的引力场 G * sum m r / |r|^3：按张角阈值theta遍历，被接受的节点用质心（及四极矩）近似，
+    // 近处叶节点的天体直接求和，位于天体内部的点不计该天体。任意点没有上一步的加速度，Relative判据按几何判据。
+    // 只读且使用固定大小的栈、不分配内存，可由多个线程同时调用
+    Vector3D fieldAt(const Vector3D& position, double theta, double gravityConstant,
+                     OpeningCriterion criterion = OpeningCriterion::Geometric) const;
+
+    // 距离小于半径之和的全部天体对（原下标，i < j），按 (i, j) 升序写入pairs。
+    // 每个天体对树做范围查询：节点的范围是以质心为中心、半径bmax的球，按天体半径加上子树内的最大半径扩展，
+    // 只查找排序后位于它之后的天体。
+    // 位置取建树（或refit）时的位置
+    void findContacts(std::vector<std::pair<uint32_t, uint32_t>>& pairs) const;
+
+    // 沿用另一棵树的更新统计（两棵树交替使用时计数保持连续）
+    void continueUpdateStats(const LinearOctree& previous) { updateStats_ = previous.updateStats_; }
+
+    // 节点访问
+    double halfSize(uint32_t node) const { return halfSize_[node]; }
+    double mass(uint32_t node) const { return mass_[node]; }
+    Vector3D centerOfMass(uint32_t node) const { return Vector3D(comX_[node], comY_[node], comZ_[node]); }
+    bool isLeaf(uint32_t node) const { return childCount_[node] == 0; }
+    uint32_t firstChild(uint32_t node) const { return firstChild_[node]; }
+    uint32_t childCount(uint32_t node) const { return childCount_[node]; }
+    uint32_t bodyBegin(uint32_t node) const { return bodyBegin_[node]; }
+    uint32_t bodyCount(uint32_t node) const { return bodyCount_[node]; }
+
+    // 按层访问：第level层的节点为 [levelBegin(level), levelBegin(level + 1))
+    size_t levelCount() const { return levelStart_.empty() ? 0 : levelStart_.size() - 1; }
+    size_t levelBegin(size_t level) const { return levelStart_[level]; }
+
+    // 排序后的天体：第k个为原天体order()[k]，叶节点的天体在这些数组中连续
+    const uint32_t* order() const { return order_.data(); }
+    const double* sortedX() const { return bodyX_.data(); }
+    const double* sortedY() const { return bodyY_.data(); }
+    const double* sortedZ() const { return bodyZ_.data(); }
+    const double* sortedMass() const { return bodyMass_.data(); }
+    const double* sortedRadius() const { return bodyRadius_.data(); }
+
+private:
+    // 节点数组（SoA）。halfSize_是节点边界的半边长：建树时等于格子的半边长，refit后可能更大
+    AlignedVector<double> centerX_, centerY_, centerZ_, halfSize_;
+    AlignedVector<double> mass_, comX_, comY_, comZ_;
+    AlignedVector<double> qxx_, qxy_, qxz_, qyy_, qyz_, qzz_;  // 关于质心的无迹四极矩（quadrupole_时有效）
+    AlignedVector<double> bmax_;  // 节点内天体到质心的最大距离的上界，供BMax判据和碰撞查询使用
+    AlignedVector<double> rmax_;  // 节点内天体的最大半径，供碰撞查询使用
+    std::vector<uint32_t> firstChild_;
+    std::vector<uint8_t> childCount_;
+    std::vector<uint32_t> bodyBegin_, bodyCount_;  // 节点覆盖的天体在order_中的范围
+
+    size_t nodeCount_ = 0;
+    size_t nodeCapacity_ = 0;
+    size_t lastBuildNodes_ = 0;  // 上一次建树的节点数，用于预留下一次的容量
+
+    // 天体按Morton键排序后的下标及对应的键
+    std::vector<uint32_t> order_;
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> levelStart_;  // 第L层节点的起始下标，最后一项为节点总数
+    AlignedVector<double> bodyX_, bodyY_, bodyZ_, bodyMass_, bodyRadius_;  // 按order_排列的天体数据
+    size_t leafCapacity_ = 1;
+    bool quadrupole_ = false;
+    // 最近一次建树时的根立方体和天体布局，决定能否refit
+    double rootX_ = 0, rootY_ = 0, rootZ_ = 0, rootHalfSize_ = 0;
+    unsigned long builtLayout_ = 0;
+
+    // 分组遍历的组（子树根节点，按Morton顺序）及各组在order_中的起点（最后一项为天体数），
+    // 组与其天体一起作为CostZones的工作项
+    size_t groupSize_ = 0;
+    std::vector<uint32_t> groups_, groupStart_;
+
+    // 一组的交互表，SoA连续存放供SIMD核函数读取：被接受的节点在前、打开的叶节点中的天体在后。
+    // 节点的半径为0（质心近似不做碰撞排除），四极矩只在quadrupole_时填写
+    struct InteractionList {
+        AlignedVector<double> x, y, z, mass, radius;
+        AlignedVector<double> qxx, qxy, qxz, qyy, qyz, qzz;
+        size_t nodes = 0;
+        std::vector<uint32_t> leaves;  // 遍历中打开的叶节点，其天体在全部节点之后追加
+        // Mixed/Float精度：源和目标的单精度坐标（Mixed时相对组中心，并带低位部分）
+        AlignedVector<float> fx, fy, fz, fxlo, fylo, fzlo, gm, fradius;
+        AlignedVector<float> tx, ty, tz, txlo, tylo, tzlo, tradius, zeros;
+        AlignedVector<double> ax, ay, az;
+        void clear();
+    };
+    mutable std::vector<InteractionList> lists_;  // 每线程一份，跨步复用
+
+    // 建树的暂存区，跨步复用
+    std::vector<uint64_t> scratchKeys_;
+    std::vector<uint32_t> scratchOrder_;
+    std::vector<size_t> radixCounts_;
+    std::vector<uint32_t> splits_;       // 当前层每个节点的9个卦限边界
+    std::vector<uint32_t> childTotals_;  // 当前层每个节点的子节点数及其前缀和
+
+    TreeMemoryStats stats_;
+    TreeUpdateStats updateStats_;
+
+    static constexpr size_t kBytesPerNode =
+        16 * sizeof(double) + 3 * sizeof(uint32_t) + sizeof(uint8_t);
+
+    // 保证arena至少能容纳nodes个节点，不足时按2倍扩容（保留已有节点）
+    void reserveNodes(size_t nodes);
+    uint32_t appendNode(double cx, double cy, double cz, double half, uint32_t begin, uint32_t count);
+    void setNode(uint32_t k, double cx, double cy, double cz, double half, uint32_t begin, uint32_t count);
+    void updateMemoryStats();
+    // 切分第level层的节点[begin, end)，在其后连续追加下一层节点
+    void emitLevel(size_t begin, size_t end, int level, bool parallel);
+    void computeMoments(bool parallel);
+    // 保持拓扑不变，按当前位置重新收集排序后的天体坐标，自底向上重算节点边界（halfSize_）和矩，返回重叠度
+    double refit(const BodyStore& store);
+
+    // 接受判据的目标：单个天体（半边长为0）或一组天体的包围盒。
+    // limit = errorTolerance * |a| / G，分组时取组内最小的|a|；不使用Relative判据或|a|为0时为0
+    struct Target {
+        double x, y, z;
+        double hx, hy, hz;
+        double limit;
+    };
+    // distance为节点质心到目标的最近距离
+    bool accepts(uint32_t node, double distance, const Target& target, const TreeForceParams& params) const;
+    // 排序后[begin, end)天体的Relative判据limit（见Target）
+    double relativeLimit(const BodyStore& store, uint32_t begin, uint32_t end,
+                         const TreeForceParams& params) const;
+
+    // 被接受节点的四极项加速度，(dx, dy, dz)为目标指向节点质心的位移
+    Vector3D quadrupoleAcceleration(uint32_t node, double dx, double dy, double dz,
+                                    double gravityConstant) const;
+    void collectGroups();
+    // 遍历一次得到组的交互表，对组内每个天体求加速度并交给emit(slot, a)，返回相互作用数
+    template <class Emit>
+    uint32_t walkGroup(uint32_t group, const TreeForceParams& params, double limit, const KernelSet& kernels,
+                       ForcePrecision precision, InteractionList& list, Emit&& emit) const;
+    // 排序后第slot个天体的加速度
+    template <class Real, class P>
+    Vector3D accelerationOn(size_t slot, const TreeForceParams& params, double limit, const KernelSet& kernels,
+                            bool floatCoordinates, uint32_t& interactions) const;
+};
+
+} // namespace GEngine
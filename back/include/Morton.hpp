@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+namespace GEngine {
+
+// 三维Morton（Z序）编码：每轴21位，交错成63位的键。
+// 按键排序后，同一八叉树节点内的天体在数组中连续，节点的八个子节点按卦限顺序排列。
+namespace Morton {
+
+constexpr int kBitsPerAxis = 21;
+constexpr uint32_t kCellsPerAxis = 1u << kBitsPerAxis;
+
+// 把21位整数的各位间隔两位展开
+inline uint64_t spreadBits(uint32_t v) {
+    uint64_t x = v & 0x1fffff;
+    x = (x | (x << 32)) & 0x1f00000000ffffull;
+    x = (x | (x << 16)) & 0x1f0000ff0000ffull;
+    x = (x | (x << 8)) & 0x100f00f00f00f00full;
+    x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+    x = (x | (x << 2)) & 0x1249249249249249ull;
+    return x;
+}
+
+// x占最低位，与八叉树卦限编号一致：bit0为x、bit1为y、bit2为z
+inline uint64_t encode(uint32_t ix, uint32_t iy, uint32_t iz) {
+    return spreadBits(ix) | (spreadBits(iy) << 1) | (spreadBits(iz) << 2);
+}
+
+// 坐标在[lo, lo + 2*halfSize)内的格点编号，超出范围的钳到边界格
+inline uint32_t cell(double v, double lo, double invCellSize) {
+    double c = (v - lo) * invCellSize;
+    if (!(c > 0)) return 0;
+    if (c >= static_cast<double>(kCellsPerAxis)) return kCellsPerAxis - 1;
+    return static_cast<uint32_t>(c);
+}
+
+// 第level层（根为0层）的卦限编号
+inline int octantAt(uint64_t key, int level) {
+    return static_cast<int>((key >> (3 * (kBitsPerAxis - 1 - level))) & 7);
+}
+
+} // namespace Morton
+
+} // namespace GEngine
@@ -1,14 +1,26 @@
 #pragma once
 
 #include "ISimulator.hpp"
+#include "BodyStore.hpp"
+#include "Integrator.hpp"
+#include "Placement.hpp"
+#include <memory>
 #include <vector>
 
 namespace GEngine {
 
 class NewtonianSimulator : public ISimulator {
 private:
-    std::vector<std::shared_ptr<CelestialBody>> bodies_;
+    BodyStore bodies_;
     std::vector<nlohmann::json> eventLog; // 存储事件
+    std::vector<AlignedVector<double>> threadAcc_; // 对称求和的线程私有加速度缓冲区
+    SourceReplicas replicas_; // 各NUMA节点的源天体副本
+    std::unique_ptr<IIntegrator> integrator_;  // 按配置选择，跨步保留（rk45的子步长）
+
+    // 计算当前位置的加速度；kick非空时写出加速度的同时做后半步kick
+    void computeForces(const VelocityKick* kick);
+    void computeForcesDirect(const VelocityKick* kick);
+    void computeForcesSymmetric(const VelocityKick* kick);
 
 public:
     void addBody(std::shared_ptr<CelestialBody> body) override;
@@ -23,25 +35,30 @@ public:
     
     void configure(const nlohmann::json& config) override;
 
+    nlohmann::json getDiagnostics() const override;
+
     // 实现引力场计算
     Vector3D calculateGravitationalField(const Vector3D& position) const override {
         Vector3D totalField(0, 0, 0);
         const auto& config = SimulationConfig::getInstance();
 
-        for (const auto& body : bodies_) {
-            Vector3D r = position - body->getPosition();
-            double distance = r.magnitude();
-            
-            if (distance > body->getRadius()) {  // 避免在天体内部计算
-                double fieldMagnitude = config.gravityConstant * body->getMass() / 
-                                     (distance * distance);
-                totalField = totalField + r.normalize() * (-fieldMagnitude);  // 引力场方向指向质量中心
+        for (size_t i = 0; i < bodies_.size(); ++i) {
+            Vector3D r = position - bodies_.position(i);
+            double inv = r.inverseMagnitude();
+            double radius = bodies_.radius()[i];
+
+            if (radius * inv < 1) {  // 避免在天体内部计算
+                // 引力场方向指向质量中心：-G*M * r / |r|^3
+                totalField.addScaled(r, -config.gravityConstant * bodies_.mass()[i] * inv * inv * inv);
             }
         }
         
         return totalField;
     }
 
+    // 网格点之间相互独立，按OpenMP线程并行
+    void calculateGravitationalFields(const Vector3D* positions, Vector3D* fields, size_t n) const override;
+
     //碰撞检测
     void detectCollisions();
 
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "BodyStore.hpp"
+#include "ForceKernels.hpp"
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace GEngine {
+
+// OpenMP线程的CPU绑定方式（SimulationConfig::threadAffinity）：
+//   None    - 不绑定，由操作系统调度
+//   Compact - 先占满一个NUMA节点的CPU，再使用下一个节点
+//   Scatter - 线程轮流分配到各个NUMA节点
+enum class ThreadAffinity { None, Compact, Scatter };
+
+namespace Placement {
+
+ThreadAffinity parseAffinity(const std::string& name);
+const char* affinityName(ThreadAffinity mode);
+
+// 把调用线程所在的OpenMP线程组按mode绑定到CPU。
+// 每个主线程各有自己的线程组，绑定结果按主线程缓存，设置和线程数不变时不重复绑定
+void applyAffinity(ThreadAffinity mode);
+
+// NUMA拓扑、最近一次绑定的结果
+nlohmann::json diagnostics();
+
+} // namespace Placement
+
+// 力计算中只读的源天体数组（位置、质量、半径）在每个NUMA节点上的副本。
+// 副本由该节点上的线程复制，首次写入即落在本节点内存，之后本节点线程只读本地副本。
+// 单节点机器上不建副本。
+class SourceReplicas {
+private:
+    struct Replica {
+        AlignedVector<double> x, y, z, mass, radius;
+        bool filled = false;
+    };
+    std::vector<Replica> nodes_;
+
+public:
+    // 每步位置更新后调用
+    void refresh(const BodyStore& store);
+    void clear() { nodes_.clear(); }
+
+    size_t nodeCount() const { return nodes_.size(); }
+
+    // 把base中的源天体指针换成各节点副本，节点没有副本时保持base不变
+    std::vector<DirectSumArgs> nodeArgs(const DirectSumArgs& base) const;
+};
+
+} // namespace GEngine
@@ -1,14 +1,25 @@
 #include "httplib.h"
 #include "include/NewtonianSimulator.hpp"
 #include "include/BarnesHutSimulator.hpp"
+#include "include/FmmSimulator.hpp"
 #include "include/Config.hpp"
+#include "include/Placement.hpp"
 #include <memory>
 #include <string>
 
 using namespace GEngine;
 
 std::unique_ptr<ISimulator> newtonianSimulator = std::make_unique<NewtonianSimulator>();
-std::unique_ptr<ISimulator> barnesHutSimulator = std::make_unique<NewtonianSimulator>();
+std::unique_ptr<ISimulator> barnesHutSimulator = std::make_unique<BarnesHutSimulator>();
+std::unique_ptr<ISimulator> fmmSimulator = std::make_unique<FmmSimulator>();
+
+// 按请求的algorithm参数选择模拟器："barnes-hut"、"fmm"，其余为直接求和
+ISimulator& selectSimulator(const httplib::Request& req) {
+    const std::string algorithm = req.has_param("algorithm") ? req.get_param_value("algorithm") : "";
+    if (algorithm == "barnes-hut") return *barnesHutSimulator;
+    if (algorithm == "fmm") return *fmmSimulator;
+    return *newtonianSimulator;
+}
 
 void initializeSolarSystem(ISimulator& simulator) {
     simulator.clear();
@@ -83,11 +94,11 @@ int main() {
 
     initializeSolarSystem(*newtonianSimulator);
     initializeSolarSystem(*barnesHutSimulator);
+    initializeSolarSystem(*fmmSimulator);
 
     svr.Get("/api/system-state", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
         setCorsHeaders(res);
-        bool useBarnesHut = req.has_param("algorithm") && req.get_param_value("algorithm") == "barnes-hut";
-        auto& simulator = useBarnesHut ? *barnesHutSimulator : *newtonianSimulator;
+        auto& simulator = selectSimulator(req);
         
         nlohmann::json state = simulator.getSystemState();
         res.set_content(state.dump(), "application/json");
@@ -96,8 +107,7 @@ int main() {
     svr.Post("/api/simulate", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
         setCorsHeaders(res);
         try {
-            bool useBarnesHut = req.has_param("algorithm") && req.get_param_value("algorithm") == "barnes-hut";
-            auto& simulator = useBarnesHut ? *barnesHutSimulator : *newtonianSimulator;
+            auto& simulator = selectSimulator(req);
             auto& config = SimulationConfig::getInstance();
 
             // 解析请求体中的时间控制参数
@@ -126,8 +136,7 @@ int main() {
     svr.Post("/api/jump-time", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
         setCorsHeaders(res);
         try {
-            bool useBarnesHut = req.has_param("algorithm") && req.get_param_value("algorithm") == "barnes-hut";
-            auto& simulator = useBarnesHut ? *barnesHutSimulator : *newtonianSimulator;
+            auto& simulator = selectSimulator(req);
             auto& config = SimulationConfig::getInstance();
 
             auto params = nlohmann::json::parse(req.body);
@@ -156,8 +165,7 @@ int main() {
 
     svr.Post("/api/reset", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
         setCorsHeaders(res);
-        bool useBarnesHut = req.has_param("algorithm") && req.get_param_value("algorithm") == "barnes-hut";
-        auto& simulator = useBarnesHut ? *barnesHutSimulator : *newtonianSimulator;
+        auto& simulator = selectSimulator(req);
 
         simulator.reset();
         initializeSolarSystem(simulator);
@@ -168,8 +176,7 @@ int main() {
 
     svr.Post("/api/remove", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
         setCorsHeaders(res);
-        bool useBarnesHut = req.has_param("algorithm") && req.get_param_value("algorithm") == "barnes-hut";
-        auto& simulator = useBarnesHut ? *barnesHutSimulator : *newtonianSimulator;
+        auto& simulator = selectSimulator(req);
 
         try {
             auto params = nlohmann::json::parse(req.body);
@@ -200,6 +207,7 @@ int main() {
             
             newtonianSimulator->configure(config);
             barnesHutSimulator->configure(config);
+            fmmSimulator->configure(config);
             
             res.set_content("{\"status\": \"success\"}", "application/json");
         } catch (const std::exception& e) {
@@ -211,14 +219,24 @@ int main() {
         }
     });
 
+    // 数据放置诊断：NUMA拓扑、线程绑定、天体数组的首次写入分块
+    svr.Get("/api/diagnostics", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
+        setCorsHeaders(res);
+        auto& simulator = selectSimulator(req);
+
+        nlohmann::json diagnostics;
+        diagnostics["placement"] = Placement::diagnostics();
+        diagnostics["simulator"] = simulator.getDiagnostics();
+        res.set_content(diagnostics.dump(2), "application/json");
+    });
+
     svr.Get("/api/export-config", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
         setCorsHeaders(res);
         nlohmann::json config;
         
         config["simulationConfig"] = SimulationConfig::getInstance().toJson();
         
-        bool useBarnesHut = req.has_param("algorithm") && req.get_param_value("algorithm") == "barnes-hut";
-        auto& simulator = useBarnesHut ? *barnesHutSimulator : *newtonianSimulator;
+        auto& simulator = selectSimulator(req);
         config["bodies"] = simulator.getSystemState();
         
         res.set_content(config.dump(2), "application/json");
@@ -234,13 +252,14 @@ int main() {
             }
             
             if (config.contains("bodies")) {
-                bool useBarnesHut = req.has_param("algorithm") && req.get_param_value("algorithm") == "barnes-hut";
-                auto& simulator = useBarnesHut ? *barnesHutSimulator : *newtonianSimulator;
+                auto& simulator = selectSimulator(req);
                 
-                simulator.clear();
+                std::vector<std::shared_ptr<CelestialBody>> bodies;
                 for (const auto& bodyData : config["bodies"]) {
-                    simulator.addBody(CelestialBody::fromJson(bodyData));
+                    bodies.push_back(CelestialBody::fromJson(bodyData));
                 }
+                simulator.clear();
+                simulator.addBodies(bodies);
             }
             
             res.set_content("{\"status\": \"success\"}", "application/json");
@@ -257,8 +276,7 @@ int main() {
     svr.Get("/api/gravitational-field", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
         setCorsHeaders(res);
         try {
-            bool useBarnesHut = req.has_param("algorithm") && req.get_param_value("algorithm") == "barnes-hut";
-            auto& simulator = useBarnesHut ? *barnesHutSimulator : *newtonianSimulator;
+            auto& simulator = selectSimulator(req);
 
             // 获取查询参数
             double centerX = req.has_param("centerX") ? std::stod(req.get_param_value("centerX")) : 0.0;
@@ -284,8 +302,7 @@ int main() {
     svr.Get("/api/events", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
         setCorsHeaders(res);
 
-        bool useBarnesHut = req.has_param("algorithm") && req.get_param_value("algorithm") == "barnes-hut";
-        auto& simulator = useBarnesHut ? *barnesHutSimulator : *newtonianSimulator;
+        auto& simulator = selectSimulator(req);
 
         auto events = simulator.getEvents();
 
@@ -1,95 +1,254 @@
 #include "../include/BarnesHutSimulator.hpp"
 #include "../include/Config.hpp"
+#include "../include/Placement.hpp"
 #include <algorithm>
 
 namespace GEngine {
 
+namespace {
+
+TreeBuildParams treeBuildParams() {
+    const auto& config = SimulationConfig::getInstance();
+    return TreeBuildParams{
+        static_cast<size_t>(std::max(1, config.leafCapacity)),
+        config.multipole == "quadrupole",
+        static_cast<size_t>(std::max(0, config.treeGroupSize))
+    };
+}
+
+OpeningCriterion openingCriterion() {
+    const std::string& name = SimulationConfig::getInstance().openingCriterion;
+    if (name == "bmax") return OpeningCriterion::BMax;
+    if (name == "relative") return OpeningCriterion::Relative;
+    return OpeningCriterion::Geometric;
+}
+
+nlohmann::json treeDiagnostics(const LinearOctree& tree, const RootCube& cube) {
+    return {
+        {"tree", tree.memoryStats().toJson()},
+        {"treeUpdates", tree.updateStats().toJson()},
+        {"treeDepth", tree.depth()},
+        {"rootCube", cube.toJson()}
+    };
+}
+
+} // namespace
+
 void BarnesHutSimulator::addBody(std::shared_ptr<CelestialBody> body) {
-    bodies_.push_back(body);
+    std::lock_guard<std::mutex> lock(mutex_);
+    bodies_.add(*body);
+    snapshotStale_ = true;
+}
+
+void BarnesHutSimulator::addBodies(const std::vector<std::shared_ptr<CelestialBody>>& bodies) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& body : bodies) bodies_.add(*body);
+    snapshotStale_ = true;
 }
 
 void BarnesHutSimulator::removeBody(const std::string& name) {
-    bodies_.erase(
-        std::remove_if(bodies_.begin(), bodies_.end(),
-            [&name](const auto& body) { return body->getName() == name; }),
-        bodies_.end()
-    );
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bodies_.removeByName(name) == 0) return;
+    snapshotStale_ = true;
 }
 
 void BarnesHutSimulator::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
     bodies_.clear();
+    snapshotStale_ = true;
+}
+
+void BarnesHutSimulator::publishSnapshot() {
+    auto snapshot = std::make_shared<TreeSnapshot>();
+    snapshot->tree = tree_;
+    snapshot->epoch = epoch_.load();
+    snapshot->diagnostics = stepDiagnostics(*tree_);
+    std::atomic_store(&snapshot_, std::shared_ptr<const TreeSnapshot>(std::move(snapshot)));
+    snapshotStale_ = false;
+}
+
+nlohmann::json BarnesHutSimulator::stepDiagnostics(const LinearOctree& tree) const {
+    nlohmann::json diagnostics = treeDiagnostics(tree, rootCube_);
+    diagnostics["bodyStore"] = bodies_.placementJson();
+    diagnostics["forceSchedule"] = costZones_.toJson();
+    diagnostics["integrator"] = integrator_ ? integrator_->toJson() : nlohmann::json();
+    return diagnostics;
+}
+
+void BarnesHutSimulator::publishBodiesSnapshot() const {
+    // 不动力计算用的树（增删天体后下一步重新建树），快照用一棵单独的树
+    const auto& config = SimulationConfig::getInstance();
+    auto tree = std::make_shared<LinearOctree>();
+    RootCube cube;
+    if (!config.dynamicTreeBox) {
+        tree->build(bodies_, Vector3D(0, 0, 0), config.universeSize, treeBuildParams());
+    } else {
+        cube.update(bodies_, config.treeBoxPadding, 0.0);
+        tree->build(bodies_, cube.center, cube.halfSize, treeBuildParams());
+    }
+    auto snapshot = std::make_shared<TreeSnapshot>();
+    snapshot->diagnostics = treeDiagnostics(*tree, cube);
+    snapshot->tree = std::move(tree);
+    snapshot->epoch = epoch_.load();
+    std::atomic_store(&snapshot_, std::shared_ptr<const TreeSnapshot>(std::move(snapshot)));
+    snapshotStale_ = false;
+}
+
+std::shared_ptr<const TreeSnapshot> BarnesHutSimulator::currentSnapshot() const {
+    if (snapshotStale_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (snapshotStale_) publishBodiesSnapshot();
+    }
+    return std::atomic_load(&snapshot_);
 }
 
 void BarnesHutSimulator::buildOctree() {
     const auto& config = SimulationConfig::getInstance();
-    root_ = std::make_unique<OctreeNode>(Vector3D(0, 0, 0), config.universeSize);
-    for (const auto& body : bodies_) {
-        root_->insert(body);
+    // 已发布的树不再修改：力计算用的树被快照持有时换到最新的一棵空闲备用树（都被查询方持有时另建一棵），
+    // 否则原地更新。同一步内之后的力计算（多级积分器）因此都在本步的树上refit
+    if (!tree_ || tree_.use_count() > 1) {
+        std::shared_ptr<LinearOctree> next;
+        for (size_t k = spareTrees_.size(); k-- > 0;) {
+            if (spareTrees_[k].use_count() == 1) {
+                next = std::move(spareTrees_[k]);
+                spareTrees_.erase(spareTrees_.begin() + k);
+                break;
+            }
+        }
+        if (!next) next = std::make_shared<LinearOctree>();
+        if (tree_) {
+            next->continueUpdateStats(*tree_);
+            spareTrees_.push_back(std::move(tree_));
+            if (spareTrees_.size() > kSpareTrees) spareTrees_.erase(spareTrees_.begin());
+        }
+        tree_ = std::move(next);
+    }
+
+    const TreeBuildParams params = treeBuildParams();
+    if (!config.dynamicTreeBox) {
+        tree_->update(bodies_, Vector3D(0, 0, 0), config.universeSize, params, config.treeRefitMaxOverlap);
+    } else {
+        rootCube_.update(bodies_, config.treeBoxPadding, config.treeBoxHysteresis);
+        tree_->update(bodies_, rootCube_.center, rootCube_.halfSize, params, config.treeRefitMaxOverlap);
     }
 }
 
-void BarnesHutSimulator::step() {
+void BarnesHutSimulator::computeForces(const VelocityKick* kick, bool previousAccelerations) {
+    const auto& config = SimulationConfig::getInstance();
     buildOctree();
+    // Relative判据需要上一步的加速度，没有时（首步、天体或配置变化后）按几何判据
+    OpeningCriterion criterion = openingCriterion();
+    if (criterion == OpeningCriterion::Relative && !previousAccelerations) criterion = OpeningCriterion::Geometric;
+    const TreeForceParams params{
+        config.barnesHutTheta, config.gravityConstant,
+        config.softeningLength * config.softeningLength,
+        criterion, config.targetForceError
+    };
+    tree_->computeAccelerations(bodies_, params, ForceKernels::activePrecision(),
+                                ForceKernels::activePolicy(), kick, &costZones_);
+}
+
+void BarnesHutSimulator::step() {
+    std::lock_guard<std::mutex> lock(mutex_);
     const auto& config = SimulationConfig::getInstance();
-    for (size_t i = 0; i < bodies_.size(); ++i) {
-        Vector3D force = root_->calculateForce(*bodies_[i]);
-        bodies_[i]->setAcceleration(force * (1.0 / bodies_[i]->getMass()));
-    }
+    const double dt = config.timeDirectionForward ? config.timeStep : -config.timeStep;
+
+    Placement::applyAffinity(Placement::parseAffinity(config.threadAffinity));
+    bodies_.placeForThreads();
 
-    for (size_t i = 0; i < bodies_.size(); ++i) {
-        bodies_[i]->updateState(config.timeStep);
+    // 0. 首步或天体/配置变化后，先求出当前位置的加速度
+    if (!bodies_.accelerationsValid(config.revision())) {
+        computeForces(nullptr, false);
     }
 
-    // 3. 碰撞检测
+    // 1. 按配置的积分器推进dt，返回时加速度对应新位置
+    Integrators::select(integrator_, config.integrator, config.integratorTolerance);
+    integrator_->step(bodies_, dt, [this](const VelocityKick* kick) { computeForces(kick, true); });
+    bodies_.markAccelerationsValid(config.revision());
+
+    // 2. 碰撞检测
     detectCollisions();
+
+    // 3. 发布本步的树
+    ++epoch_;
+    publishSnapshot();
 }
 
 void BarnesHutSimulator::reset() {
-    for (auto& body : bodies_) {
-        body->setAcceleration(Vector3D(0, 0, 0));
-        body->setVelocity(Vector3D(0, 0, 0));
-    }
-    root_.reset();
+    std::lock_guard<std::mutex> lock(mutex_);
+    bodies_.resetMotion();
+    tree_.reset();
+    spareTrees_.clear();
+    rootCube_.invalidate();
+    snapshotStale_ = true;
 }
 
 nlohmann::json BarnesHutSimulator::getSystemState() const {
-    nlohmann::json state = nlohmann::json::array();
-    for (const auto& body : bodies_) {
-        state.push_back(body->toJson());
-    }
-    return state;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bodies_.toJson();
 }
 
 std::vector<std::shared_ptr<CelestialBody>> BarnesHutSimulator::getBodies() const {
-    return bodies_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bodies_.makeBodies();
 }
 
 void BarnesHutSimulator::configure(const nlohmann::json& config) {
     SimulationConfig::getInstance().loadFromJson(config);
 }
 
+nlohmann::json BarnesHutSimulator::getDiagnostics() const {
+    const std::shared_ptr<const TreeSnapshot> snapshot = currentSnapshot();
+    if (!snapshot) return { {"snapshot", nullptr} };
+    nlohmann::json diagnostics = snapshot->diagnostics;
+    diagnostics["snapshot"] = { {"epoch", snapshot->epoch} };
+    return diagnostics;
+}
+
+Vector3D BarnesHutSimulator::calculateGravitationalField(const Vector3D& position) const {
+    Vector3D field;
+    calculateGravitationalFields(&position, &field, 1);
+    return field;
+}
+
+void BarnesHutSimulator::calculateGravitationalFields(const Vector3D* positions, Vector3D* fields,
+                                                      size_t n) const {
+    const auto& config = SimulationConfig::getInstance();
+    const std::shared_ptr<const TreeSnapshot> snapshot = currentSnapshot();
+    if (!snapshot) {
+        std::fill(fields, fields + n, Vector3D(0, 0, 0));
+        return;
+    }
+    const LinearOctree* tree = snapshot->tree.get();
+
+    const double theta = config.barnesHutTheta;
+    const double G = config.gravityConstant;
+    const OpeningCriterion criterion = openingCriterion();
+    #pragma omp parallel for schedule(dynamic, 64) if(n > 64)
+    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(n); ++i) {
+        fields[i] = tree->fieldAt(positions[i], theta, G, criterion);
+    }
+}
+
 void BarnesHutSimulator::detectCollisions() {
-    for (size_t i = 0; i < bodies_.size(); ++i) {
-        for (size_t j = i + 1; j < bodies_.size(); ++j) {
-            auto bodyA = bodies_[i];
-            auto bodyB = bodies_[j];
-
-            Vector3D diff = bodyA->getPosition() - bodyB->getPosition();
-            double distance = diff.magnitude();
-            double collisionDist = bodyA->getRadius() + bodyB->getRadius();
-
-            if (distance < collisionDist) {
-                nlohmann::json collisionEvent;
-                collisionEvent["type"] = "collision";
-                collisionEvent["time"] = 0; 
-                collisionEvent["bodies"] = { bodyA->getName(), bodyB->getName() };
-                collisionEvent["distance"] = distance;
-                collisionEvent["message"] =
-                    "Collision occurred between " + bodyA->getName() + " and " + bodyB->getName();
-
-                eventLog.push_back(collisionEvent);
+    if (!tree_) return;
+    tree_->findContacts(contacts_);
+    const double* radius = bodies_.radius();
+    for (const auto& [i, j] : contacts_) {
+        Vector3D diff = bodies_.position(i) - bodies_.position(j);
+        double distance = diff.magnitude();
+        double collisionDist = radius[i] + radius[j];
 
-            }
+        if (distance < collisionDist) {
+            nlohmann::json collisionEvent;
+            collisionEvent["type"] = "collision";
+            collisionEvent["time"] = 0; 
+            collisionEvent["bodies"] = { bodies_.name(i), bodies_.name(j) };
+            collisionEvent["distance"] = distance;
+            collisionEvent["message"] =
+                "Collision occurred between " + bodies_.name(i) + " and " + bodies_.name(j);
+
+            eventLog.push_back(collisionEvent);
         }
     }
 }
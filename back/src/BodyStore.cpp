@@ -0,0 +1,207 @@
+#include "../include/BodyStore.hpp"
+#include "../include/Hardware.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <cstddef>
+
+namespace GEngine {
+
+void BodyStore::reserve(size_t n) {
+    x_.reserve(n); y_.reserve(n); z_.reserve(n);
+    vx_.reserve(n); vy_.reserve(n); vz_.reserve(n);
+    ax_.reserve(n); ay_.reserve(n); az_.reserve(n);
+    mass_.reserve(n); radius_.reserve(n);
+    names_.reserve(n);
+}
+
+void BodyStore::add(const CelestialBody& body) {
+    const Vector3D& p = body.getPosition();
+    const Vector3D& v = body.getVelocity();
+    const Vector3D& a = body.getAcceleration();
+    x_.push_back(p.x()); y_.push_back(p.y()); z_.push_back(p.z());
+    vx_.push_back(v.x()); vy_.push_back(v.y()); vz_.push_back(v.z());
+    ax_.push_back(a.x()); ay_.push_back(a.y()); az_.push_back(a.z());
+    mass_.push_back(body.getMass());
+    radius_.push_back(body.getRadius());
+    nameIndex_[body.getName()].push_back(static_cast<uint32_t>(names_.size()));
+    names_.push_back(body.getName());
+    accelerationsValid_ = false;
+    placed_ = false;
+    ++layoutRevision_;
+}
+
+size_t BodyStore::removeByName(const std::string& name) {
+    auto found = nameIndex_.find(name);
+    if (found == nameIndex_.end()) return 0;
+    const std::vector<uint32_t> removed = std::move(found->second);
+    nameIndex_.erase(found);
+
+    // 从第一个被删除的下标开始压缩，其后的天体前移，同时改写它们在索引中的下标
+    size_t out = removed.front();
+    size_t next = 0;
+    for (size_t i = out; i < names_.size(); ++i) {
+        if (next < removed.size() && removed[next] == i) {
+            ++next;
+            continue;
+        }
+        x_[out] = x_[i]; y_[out] = y_[i]; z_[out] = z_[i];
+        vx_[out] = vx_[i]; vy_[out] = vy_[i]; vz_[out] = vz_[i];
+        ax_[out] = ax_[i]; ay_[out] = ay_[i]; az_[out] = az_[i];
+        mass_[out] = mass_[i];
+        radius_[out] = radius_[i];
+        names_[out] = std::move(names_[i]);
+        for (uint32_t& index : nameIndex_[names_[out]]) {
+            if (index == i) { index = static_cast<uint32_t>(out); break; }
+        }
+        ++out;
+    }
+    x_.resize(out); y_.resize(out); z_.resize(out);
+    vx_.resize(out); vy_.resize(out); vz_.resize(out);
+    ax_.resize(out); ay_.resize(out); az_.resize(out);
+    mass_.resize(out);
+    radius_.resize(out);
+    names_.resize(out);
+    accelerationsValid_ = false;
+    placed_ = false;
+    ++layoutRevision_;
+    return removed.size();
+}
+
+const std::vector<uint32_t>* BodyStore::indicesOf(const std::string& name) const {
+    auto found = nameIndex_.find(name);
+    return found == nameIndex_.end() ? nullptr : &found->second;
+}
+
+void BodyStore::clear() {
+    x_.clear(); y_.clear(); z_.clear();
+    vx_.clear(); vy_.clear(); vz_.clear();
+    ax_.clear(); ay_.clear(); az_.clear();
+    mass_.clear();
+    radius_.clear();
+    names_.clear();
+    nameIndex_.clear();
+    accelerationsValid_ = false;
+    placed_ = false;
+    ++layoutRevision_;
+}
+
+void BodyStore::resetMotion() {
+    const ptrdiff_t n = static_cast<ptrdiff_t>(size());
+    #pragma omp parallel for
+    for (ptrdiff_t i = 0; i < n; ++i) {
+        vx_[i] = 0; vy_[i] = 0; vz_[i] = 0;
+        ax_[i] = 0; ay_[i] = 0; az_[i] = 0;
+    }
+    accelerationsValid_ = false;
+}
+
+namespace {
+
+// 由各线程按静态调度复制到新数组，首次写入决定页面所在节点
+void firstTouchCopy(AlignedVector<double>& array, ptrdiff_t n) {
+    AlignedVector<double> placed;
+    placed.resize(n);  // 不初始化
+    #pragma omp parallel for schedule(static)
+    for (ptrdiff_t i = 0; i < n; ++i) {
+        placed[i] = array[i];
+    }
+    array.swap(placed);
+}
+
+} // namespace
+
+void BodyStore::placeForThreads() {
+    if (placed_) return;
+    const ptrdiff_t n = static_cast<ptrdiff_t>(size());
+    for (auto* array : { &x_, &y_, &z_, &vx_, &vy_, &vz_, &ax_, &ay_, &az_, &mass_, &radius_ }) {
+        firstTouchCopy(*array, n);
+    }
+
+    partitions_.assign(omp_get_max_threads(), Partition{ 0, 0, -1 });
+    #pragma omp parallel
+    {
+        const int t = omp_get_thread_num();
+        const int used = omp_get_num_threads();
+        // 与 schedule(static) 相同的连续分块
+        const size_t begin = static_cast<size_t>(n) * t / used;
+        const size_t end = static_cast<size_t>(n) * (t + 1) / used;
+        partitions_[t] = Partition{ begin, end, Hardware::numaNodes()[Hardware::currentNumaNode()].id };
+    }
+    placed_ = true;
+}
+
+nlohmann::json BodyStore::placementJson() const {
+    nlohmann::json parts = nlohmann::json::array();
+    for (size_t t = 0; t < partitions_.size(); ++t) {
+        if (partitions_[t].node < 0) continue;
+        parts.push_back({
+            {"thread", t},
+            {"begin", partitions_[t].begin},
+            {"end", partitions_[t].end},
+            {"node", partitions_[t].node}
+        });
+    }
+    return { {"bodies", size()}, {"firstTouch", placed_}, {"partitions", parts} };
+}
+
+void BodyStore::kickDrift(double dt) {
+    const ptrdiff_t n = static_cast<ptrdiff_t>(size());
+    const double halfDt = dt * 0.5;
+
+    #pragma omp parallel for schedule(static)
+    for (ptrdiff_t i = 0; i < n; ++i) {
+        vx_[i] += ax_[i] * halfDt;
+        vy_[i] += ay_[i] * halfDt;
+        vz_[i] += az_[i] * halfDt;
+        x_[i] += vx_[i] * dt;
+        y_[i] += vy_[i] * dt;
+        z_[i] += vz_[i] * dt;
+    }
+    accelerationsValid_ = false;
+}
+
+bool BodyStore::bounds(Vector3D& lo, Vector3D& hi) const {
+    const ptrdiff_t n = static_cast<ptrdiff_t>(size());
+    if (n == 0) return false;
+    double minX = x_[0], minY = y_[0], minZ = z_[0];
+    double maxX = minX, maxY = minY, maxZ = minZ;
+
+    #pragma omp parallel for schedule(static) \
+        reduction(min:minX, minY, minZ) reduction(max:maxX, maxY, maxZ)
+    for (ptrdiff_t i = 0; i < n; ++i) {
+        minX = std::min(minX, x_[i]); maxX = std::max(maxX, x_[i]);
+        minY = std::min(minY, y_[i]); maxY = std::max(maxY, y_[i]);
+        minZ = std::min(minZ, z_[i]); maxZ = std::max(maxZ, z_[i]);
+    }
+    lo = Vector3D(minX, minY, minZ);
+    hi = Vector3D(maxX, maxY, maxZ);
+    return true;
+}
+
+std::shared_ptr<CelestialBody> BodyStore::makeBody(size_t i) const {
+    auto body = std::make_shared<CelestialBody>(
+        names_[i], mass_[i], radius_[i], position(i), velocity(i));
+    body->setAcceleration(acceleration(i));
+    return body;
+}
+
+std::vector<std::shared_ptr<CelestialBody>> BodyStore::makeBodies() const {
+    std::vector<std::shared_ptr<CelestialBody>> bodies;
+    bodies.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        bodies.push_back(makeBody(i));
+    }
+    return bodies;
+}
+
+nlohmann::json BodyStore::toJson() const {
+    nlohmann::json state = nlohmann::json::array();
+    for (size_t i = 0; i < size(); ++i) {
+        CelestialBody body(names_[i], mass_[i], radius_[i], position(i), velocity(i));
+        body.setAcceleration(acceleration(i));
+        state.push_back(body.toJson());
+    }
+    return state;
+}
+
+} // namespace GEngine
@@ -0,0 +1,92 @@
+#include "../include/CostZones.hpp"
+#include <algorithm>
+
+namespace GEngine {
+
+uint64_t CostZones::itemCost(const uint32_t* order, const uint32_t* itemStart, size_t k) const {
+    if (!itemStart) return cost_[order[k]];
+    uint64_t sum = 0;
+    for (uint32_t s = itemStart[k]; s < itemStart[k + 1]; ++s) sum += cost_[order[s]];
+    return sum;
+}
+
+void CostZones::partition(const uint32_t* order, const uint32_t* itemStart, size_t n, int threads) {
+    threads_ = threads;
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(n, size_t(threads) * kChunksPerThread));
+
+    // 各工作项的代价先求出，切块时直接累加
+    itemCost_.resize(n);
+    uint64_t total = 0;
+    for (size_t k = 0; k < n; ++k) total += itemCost_[k] = itemCost(order, itemStart, k);
+
+    // 第c块在累计代价达到 total * c / chunks 处开始
+    chunkStart_.resize(chunks + 1);
+    chunkStart_[0] = 0;
+    uint64_t running = 0;
+    size_t k = 0;
+    for (size_t c = 1; c < chunks; ++c) {
+        const uint64_t target = total * c / chunks;
+        while (k < n && running < target) running += itemCost_[k++];
+        chunkStart_[c] = static_cast<uint32_t>(k);
+    }
+    chunkStart_[chunks] = static_cast<uint32_t>(n);
+
+    for (int t = 0; t < threads; ++t) {
+        const uint32_t front = static_cast<uint32_t>(chunks * t / threads);
+        const uint32_t back = static_cast<uint32_t>(chunks * (t + 1) / threads);
+        queues_[t].range.store(pack(front, back), std::memory_order_relaxed);
+        queues_[t].cost = 0;
+        queues_[t].steals = 0;
+    }
+}
+
+bool CostZones::popFront(Queue& q, uint32_t& chunk) {
+    uint64_t range = q.range.load(std::memory_order_relaxed);
+    for (;;) {
+        const uint32_t front = static_cast<uint32_t>(range);
+        const uint32_t back = static_cast<uint32_t>(range >> 32);
+        if (front >= back) return false;
+        if (q.range.compare_exchange_weak(range, pack(front + 1, back), std::memory_order_relaxed)) {
+            chunk = front;
+            return true;
+        }
+    }
+}
+
+bool CostZones::popBack(Queue& q, uint32_t& chunk) {
+    uint64_t range = q.range.load(std::memory_order_relaxed);
+    for (;;) {
+        const uint32_t front = static_cast<uint32_t>(range);
+        const uint32_t back = static_cast<uint32_t>(range >> 32);
+        if (front >= back) return false;
+        if (q.range.compare_exchange_weak(range, pack(front, back - 1), std::memory_order_relaxed)) {
+            chunk = back - 1;
+            return true;
+        }
+    }
+}
+
+void CostZones::collectStats() {
+    totalCost_ = 0;
+    maxThreadCost_ = 0;
+    steals_ = 0;
+    for (int t = 0; t < threads_; ++t) {
+        totalCost_ += queues_[t].cost;
+        maxThreadCost_ = std::max(maxThreadCost_, queues_[t].cost);
+        steals_ += queues_[t].steals;
+    }
+}
+
+nlohmann::json CostZones::toJson() const {
+    // 负载不均衡度：最忙线程的代价 / 平均代价，1表示完全均衡
+    const double mean = threads_ > 0 ? double(totalCost_) / threads_ : 0;
+    return {
+        {"threads", threads_},
+        {"chunks", chunkStart_.empty() ? 0 : chunkStart_.size() - 1},
+        {"interactions", totalCost_},
+        {"steals", steals_},
+        {"imbalance", mean > 0 ? double(maxThreadCost_) / mean : 1.0}
+    };
+}
+
+} // namespace GEngine
@@ -0,0 +1,156 @@
+#include "../include/FmmSimulator.hpp"
+#include "../include/Config.hpp"
+#include "../include/Placement.hpp"
+#include <algorithm>
+
+namespace GEngine {
+
+void FmmSimulator::invalidateTree() {
+    tree_.clear();
+    solver_.clear();
+}
+
+void FmmSimulator::addBody(std::shared_ptr<CelestialBody> body) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bodies_.add(*body);
+    invalidateTree();
+}
+
+void FmmSimulator::removeBody(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bodies_.removeByName(name) == 0) return;
+    invalidateTree();
+}
+
+void FmmSimulator::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bodies_.clear();
+    invalidateTree();
+}
+
+void FmmSimulator::computeForces(const VelocityKick* kick) {
+    const auto& config = SimulationConfig::getInstance();
+    const TreeBuildParams buildParams{ static_cast<size_t>(std::max(1, config.fmmLeafCapacity)), false };
+    if (config.dynamicTreeBox) {
+        rootCube_.update(bodies_, config.treeBoxPadding, config.treeBoxHysteresis);
+        tree_.update(bodies_, rootCube_.center, rootCube_.halfSize, buildParams, config.treeRefitMaxOverlap);
+    } else {
+        tree_.update(bodies_, Vector3D(0, 0, 0), config.universeSize, buildParams, config.treeRefitMaxOverlap);
+    }
+
+    const FmmParams params{
+        config.fmmOrder, config.fmmTheta, config.gravityConstant,
+        config.softeningLength * config.softeningLength
+    };
+    solver_.computeAccelerations(bodies_, tree_, params, ForceKernels::activePolicy(), kick);
+}
+
+void FmmSimulator::step() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto& config = SimulationConfig::getInstance();
+    const double dt = config.timeDirectionForward ? config.timeStep : -config.timeStep;
+
+    Placement::applyAffinity(Placement::parseAffinity(config.threadAffinity));
+    bodies_.placeForThreads();
+
+    // 0. 首步或天体/配置变化后，先求出当前位置的加速度
+    if (!bodies_.accelerationsValid(config.revision())) {
+        computeForces(nullptr);
+    }
+
+    // 1. 按配置的积分器推进dt，返回时加速度对应新位置
+    Integrators::select(integrator_, config.integrator, config.integratorTolerance);
+    integrator_->step(bodies_, dt, [this](const VelocityKick* kick) { computeForces(kick); });
+    bodies_.markAccelerationsValid(config.revision());
+
+    // 2. 碰撞检测
+    detectCollisions();
+}
+
+void FmmSimulator::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bodies_.resetMotion();
+    invalidateTree();
+    rootCube_.invalidate();
+}
+
+nlohmann::json FmmSimulator::getSystemState() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bodies_.toJson();
+}
+
+std::vector<std::shared_ptr<CelestialBody>> FmmSimulator::getBodies() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bodies_.makeBodies();
+}
+
+void FmmSimulator::configure(const nlohmann::json& config) {
+    SimulationConfig::getInstance().loadFromJson(config);
+}
+
+nlohmann::json FmmSimulator::getDiagnostics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {
+        {"bodyStore", bodies_.placementJson()},
+        {"tree", tree_.memoryStats().toJson()},
+        {"treeUpdates", tree_.updateStats().toJson()},
+        {"treeDepth", tree_.depth()},
+        {"rootCube", rootCube_.toJson()},
+        {"fmm", solver_.toJson()},
+        {"integrator", integrator_ ? integrator_->toJson() : nlohmann::json()}
+    };
+}
+
+Vector3D FmmSimulator::calculateGravitationalField(const Vector3D& position) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fieldAt(position);
+}
+
+Vector3D FmmSimulator::fieldAt(const Vector3D& position) const {
+    Vector3D field;
+    if (solver_.fieldAt(tree_, position, field)) return field;
+
+    const auto& config = SimulationConfig::getInstance();
+    Vector3D totalField(0, 0, 0);
+    for (size_t i = 0; i < bodies_.size(); ++i) {
+        Vector3D r = position - bodies_.position(i);
+        double inv = r.inverseMagnitude();
+        double radius = bodies_.radius()[i];
+        if (radius * inv < 1) {
+            totalField.addScaled(r, -config.gravityConstant * bodies_.mass()[i] * inv * inv * inv);
+        }
+    }
+    return totalField;
+}
+
+void FmmSimulator::calculateGravitationalFields(const Vector3D* positions, Vector3D* fields, size_t n) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(n); ++i) {
+        fields[i] = fieldAt(positions[i]);
+    }
+}
+
+void FmmSimulator::detectCollisions() {
+    tree_.findContacts(contacts_);
+    const double* radius = bodies_.radius();
+    for (const auto& [i, j] : contacts_) {
+        Vector3D diff = bodies_.position(i) - bodies_.position(j);
+        double distance = diff.magnitude();
+        double collisionDist = radius[i] + radius[j];
+
+        if (distance < collisionDist) {
+            nlohmann::json collisionEvent;
+            collisionEvent["type"] = "collision";
+            collisionEvent["time"] = 0;
+            collisionEvent["bodies"] = { bodies_.name(i), bodies_.name(j) };
+            collisionEvent["distance"] = distance;
+            collisionEvent["message"] =
+                "Collision occurred between " + bodies_.name(i) + " and " + bodies_.name(j);
+
+            eventLog.push_back(collisionEvent);
+        }
+    }
+}
+
+} // namespace GEngine
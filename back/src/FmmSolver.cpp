@@ -0,0 +1,419 @@
+#include "../include/FmmSolver.hpp"
+#include "../include/ForcePolicies.hpp"
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+
+namespace GEngine {
+
+namespace {
+
+// p+1阶（场计算）的指标数上限
+constexpr size_t kMaxTerms =
+    (FmmSolver::kMaxOrder + 2) * (FmmSolver::kMaxOrder + 3) * (FmmSolver::kMaxOrder + 4) / 6;
+
+// 天体数超过此值的节点，其子节点作为OpenMP任务并行遍历
+constexpr uint32_t kTaskBodies = 2048;
+
+double factorial(int n) {
+    double f = 1;
+    for (int i = 2; i <= n; ++i) f *= i;
+    return f;
+}
+
+} // namespace
+
+void FmmSolver::Terms::build(int p) {
+    if (order == p) return;
+    order = p;
+    index.clear();
+    for (int d = 0; d <= p; ++d) {
+        for (int x = d; x >= 0; --x) {
+            for (int y = d - x; y >= 0; --y) {
+                index.push_back({ uint8_t(x), uint8_t(y), uint8_t(d - x - y) });
+            }
+        }
+    }
+    lookup.assign(size_t(p + 2) * (p + 2) * (p + 2), -1);
+    invFactorial.resize(index.size());
+    for (size_t i = 0; i < index.size(); ++i) {
+        const auto& k = index[i];
+        lookup[(k[0] * (p + 2) + k[1]) * (p + 2) + k[2]] = static_cast<int>(i);
+        invFactorial[i] = 1 / (factorial(k[0]) * factorial(k[1]) * factorial(k[2]));
+    }
+
+    recurrence.assign(index.size(), Recurrence{});
+    for (size_t i = 1; i < index.size(); ++i) {
+        const auto& k = index[i];
+        const int n = k[0] + k[1] + k[2];
+        auto& rec = recurrence[i];
+        for (int axis = 0; axis < 3; ++axis) {
+            int lower[3] = { k[0], k[1], k[2] };
+            if (k[axis] > 0) {
+                --lower[axis];
+                rec.first[axis] = uint32_t(at(lower[0], lower[1], lower[2]));
+                rec.firstCoef[axis] = -double(2 * n - 1) * k[axis] / n;
+            }
+            if (k[axis] > 1) {
+                --lower[axis];
+                rec.second[axis] = uint32_t(at(lower[0], lower[1], lower[2]));
+                rec.secondCoef[axis] = -double(n - 1) * k[axis] * (k[axis] - 1) / n;
+            }
+        }
+    }
+
+    shifts.clear();
+    for (size_t a = 0; a < index.size(); ++a) {
+        const auto& k = index[a];
+        for (size_t b = 0; b < index.size(); ++b) {
+            const auto& l = index[b];
+            if (l[0] <= k[0] && l[1] <= k[1] && l[2] <= k[2]) {
+                shifts.push_back({ uint32_t(a), uint32_t(b),
+                                   uint32_t(at(k[0] - l[0], k[1] - l[1], k[2] - l[2])),
+                                   invFactorial[b] / invFactorial[a] });
+            }
+        }
+    }
+    sign.resize(index.size());
+    m2lStart.clear();
+    m2lCount.clear();
+    m2lIndex.clear();
+    for (size_t a = 0; a < index.size(); ++a) {
+        const auto& n = index[a];
+        sign[a] = (n[0] + n[1] + n[2]) % 2 ? -1.0 : 1.0;
+        m2lStart.push_back(uint32_t(m2lIndex.size()));
+        for (const auto& k : index) {
+            if (k[0] + k[1] + k[2] + n[0] + n[1] + n[2] > p) break;
+            m2lIndex.push_back(uint32_t(at(k[0] + n[0], k[1] + n[1], k[2] + n[2])));
+        }
+        m2lCount.push_back(uint32_t(m2lIndex.size()) - m2lStart.back());
+    }
+}
+
+namespace {
+
+// s^k / k!，|k| <= order
+template <class T>
+void scaledPowers(const T& terms, double sx, double sy, double sz, double* out) {
+    double px[FmmSolver::kMaxOrder + 2], py[FmmSolver::kMaxOrder + 2], pz[FmmSolver::kMaxOrder + 2];
+    px[0] = py[0] = pz[0] = 1;
+    for (int i = 1; i <= terms.order; ++i) {
+        px[i] = px[i - 1] * sx;
+        py[i] = py[i - 1] * sy;
+        pz[i] = pz[i - 1] * sz;
+    }
+    for (size_t i = 0; i < terms.size(); ++i) {
+        const auto& k = terms.index[i];
+        out[i] = px[k[0]] * py[k[1]] * pz[k[2]] * terms.invFactorial[i];
+    }
+}
+
+// D^n(1/r)在R处的值，|n| <= order，按递推由低阶求高阶
+template <class T>
+void derivatives(const T& terms, double rx, double ry, double rz, double* d) {
+    const double invR2 = 1 / (rx * rx + ry * ry + rz * rz);
+    d[0] = std::sqrt(invR2);
+    for (size_t i = 1; i < terms.size(); ++i) {
+        const auto& rec = terms.recurrence[i];
+        d[i] = (rec.firstCoef[0] * rx * d[rec.first[0]] + rec.firstCoef[1] * ry * d[rec.first[1]]
+              + rec.firstCoef[2] * rz * d[rec.first[2]] + rec.secondCoef[0] * d[rec.second[0]]
+              + rec.secondCoef[1] * d[rec.second[1]] + rec.secondCoef[2] * d[rec.second[2]]) * invR2;
+    }
+}
+
+} // namespace
+
+void FmmSolver::upwardPass(const LinearOctree& tree) {
+    const size_t T = terms_.size();
+    const double* bx = tree.sortedX();
+    const double* by = tree.sortedY();
+    const double* bz = tree.sortedZ();
+    const double* bm = tree.sortedMass();
+
+    for (size_t level = tree.levelCount(); level-- > 0;) {
+        const ptrdiff_t begin = static_cast<ptrdiff_t>(tree.levelBegin(level));
+        const ptrdiff_t end = static_cast<ptrdiff_t>(tree.levelBegin(level + 1));
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (ptrdiff_t k = begin; k < end; ++k) {
+            const uint32_t node = static_cast<uint32_t>(k);
+            const Vector3D c = tree.centerOfMass(node);
+            double* m = multipole_.data() + node * T;
+            double pw[kMaxTerms];
+            std::fill(m, m + T, 0.0);
+            double r = 0;
+
+            if (tree.isLeaf(node)) {
+                // P2M
+                for (uint32_t j = tree.bodyBegin(node), e = j + tree.bodyCount(node); j < e; ++j) {
+                    const double sx = bx[j] - c.x(), sy = by[j] - c.y(), sz = bz[j] - c.z();
+                    scaledPowers(terms_, sx, sy, sz, pw);
+                    for (size_t i = 0; i < T; ++i) m[i] += bm[j] * pw[i];
+                    r = std::max(r, std::sqrt(sx * sx + sy * sy + sz * sz));
+                }
+            } else {
+                // M2M：子节点的多极矩平移到本节点质心
+                for (uint32_t ch = tree.firstChild(node), e = ch + tree.childCount(node); ch < e; ++ch) {
+                    const Vector3D d = tree.centerOfMass(ch) - c;
+                    scaledPowers(terms_, d.x(), d.y(), d.z(), pw);
+                    const double* mc = multipole_.data() + ch * T;
+                    for (const auto& s : terms_.shifts) m[s.k] += mc[s.l] * pw[s.diff];
+                    r = std::max(r, d.magnitude() + radius_[ch]);
+                }
+            }
+            radius_[node] = r;
+        }
+    }
+}
+
+void FmmSolver::interact(const LinearOctree& tree, uint32_t target, const std::vector<uint32_t>& candidates,
+                         const KernelSet& kernels) {
+    const size_t T = terms_.size();
+    const bool targetLeaf = tree.isLeaf(target);
+    const Vector3D ca = tree.centerOfMass(target);
+    double* la = local_.data() + target * T;
+    const DirectSumArgs leafArgs{ tree.sortedX(), tree.sortedY(), tree.sortedZ(),
+                                  tree.sortedMass(), tree.sortedRadius(), nullptr, nullptr, nullptr,
+                                  params_.gravityConstant, params_.softening2 };
+    size_t m2l = 0, p2p = 0;
+    double d[kMaxTerms], signedM[kMaxTerms];
+
+    // 候选源节点在本线程的栈上展开。循环中没有任务调度点，栈在返回前不会被其他调用使用；
+    // 留给子节点的源节点放在本次调用自己的deferred中，子节点（及其任务）只读它
+    std::vector<uint32_t>& pending = pending_[omp_get_thread_num()];
+    pending.assign(candidates.begin(), candidates.end());
+    std::vector<uint32_t> deferred;
+    while (!pending.empty()) {
+        const uint32_t source = pending.back();
+        pending.pop_back();
+        const Vector3D r = ca - tree.centerOfMass(source);
+        const double distance = r.magnitude();
+
+        if (radius_[target] + radius_[source] < params_.theta * distance) {
+            // M2L
+            derivatives(terms_, r.x(), r.y(), r.z(), d);
+            const double* mb = multipole_.data() + source * T;
+            for (size_t k = 0; k < T; ++k) signedM[k] = terms_.sign[k] * mb[k];
+            for (size_t n = 0; n < T; ++n) {
+                const uint32_t* kn = terms_.m2lIndex.data() + terms_.m2lStart[n];
+                double sum = 0;
+                for (uint32_t k = 0, e = terms_.m2lCount[n]; k < e; ++k) sum += signedM[k] * d[kn[k]];
+                la[n] += sum * terms_.invFactorial[n];
+            }
+            ++m2l;
+            continue;
+        }
+
+        const bool sourceLeaf = tree.isLeaf(source);
+        if (targetLeaf && sourceLeaf) {
+            // P2P：目标与源为同一叶节点时，自身距离为0由掩码排除
+            const uint32_t j0 = tree.bodyBegin(source), j1 = j0 + tree.bodyCount(source);
+            for (uint32_t i = tree.bodyBegin(target), e = i + tree.bodyCount(target); i < e; ++i) {
+                double acc[3] = { 0, 0, 0 };
+                kernels.leafSum(leafArgs, j0, j1, leafArgs.x[i], leafArgs.y[i], leafArgs.z[i],
+                                leafArgs.radius[i], acc);
+                accX_[i] += acc[0];
+                accY_[i] += acc[1];
+                accZ_[i] += acc[2];
+            }
+            p2p += size_t(tree.bodyCount(target)) * tree.bodyCount(source);
+            continue;
+        }
+
+        if (targetLeaf || (!sourceLeaf && radius_[source] > radius_[target])) {
+            for (uint32_t ch = tree.firstChild(source), e = ch + tree.childCount(source); ch < e; ++ch) {
+                pending.push_back(ch);
+            }
+        } else {
+            deferred.push_back(source);
+        }
+    }
+
+    #pragma omp atomic
+    m2lCount_ += m2l;
+    #pragma omp atomic
+    p2pPairs_ += p2p;
+
+    if (deferred.empty()) return;
+    const bool spawn = tree.bodyCount(target) > kTaskBodies;
+    for (uint32_t ch = tree.firstChild(target), e = ch + tree.childCount(target); ch < e; ++ch) {
+        if (spawn) {
+            #pragma omp task firstprivate(ch) shared(tree, kernels, deferred)
+            interact(tree, ch, deferred, kernels);
+        } else {
+            interact(tree, ch, deferred, kernels);
+        }
+    }
+    // 子任务共享deferred，等它们完成后才能释放
+    if (spawn) {
+        #pragma omp taskwait
+    }
+}
+
+void FmmSolver::downwardPass(const LinearOctree& tree) {
+    const size_t T = terms_.size();
+    // L2L：自顶向下把父节点的局部展开平移到子节点质心
+    for (size_t level = 0; level + 1 < tree.levelCount(); ++level) {
+        const ptrdiff_t begin = static_cast<ptrdiff_t>(tree.levelBegin(level));
+        const ptrdiff_t end = static_cast<ptrdiff_t>(tree.levelBegin(level + 1));
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (ptrdiff_t k = begin; k < end; ++k) {
+            const uint32_t node = static_cast<uint32_t>(k);
+            if (tree.isLeaf(node)) continue;
+            const double* lp = local_.data() + node * T;
+            double pw[kMaxTerms];
+            for (uint32_t ch = tree.firstChild(node), e = ch + tree.childCount(node); ch < e; ++ch) {
+                const Vector3D t = tree.centerOfMass(ch) - tree.centerOfMass(node);
+                scaledPowers(terms_, t.x(), t.y(), t.z(), pw);
+                double* lc = local_.data() + ch * T;
+                for (const auto& s : terms_.shifts) lc[s.l] += lp[s.k] * s.l2l * pw[s.diff];
+            }
+        }
+    }
+}
+
+void FmmSolver::computeAccelerations(BodyStore& store, const LinearOctree& tree, const FmmParams& params,
+                                     const KernelPolicy& policy, const VelocityKick* kick) {
+    nodes_ = 0;
+    if (tree.empty()) return;
+    params_ = params;
+    params_.order = std::clamp(params.order, 1, kMaxOrder);
+    terms_.build(params_.order);
+    derivTerms_.build(params_.order + 1);
+
+    const size_t T = terms_.size();
+    const size_t nodes = tree.nodeCount();
+    const ptrdiff_t n = static_cast<ptrdiff_t>(store.size());
+    multipole_.resize(nodes * T);
+    local_.resize(nodes * T);
+    radius_.resize(nodes);
+    accX_.resize(n);
+    accY_.resize(n);
+    accZ_.resize(n);
+
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(static) nowait
+        for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(nodes * T); ++i) local_[i] = 0;
+        #pragma omp for schedule(static)
+        for (ptrdiff_t i = 0; i < n; ++i) accX_[i] = accY_[i] = accZ_[i] = 0;
+    }
+
+    upwardPass(tree);
+
+    const KernelSet& kernels = ForceKernels::selectKernels(ForceKernels::activeSimdLevel(), policy);
+    m2lCount_ = 0;
+    p2pPairs_ = 0;
+    if (pending_.size() < static_cast<size_t>(omp_get_max_threads())) pending_.resize(omp_get_max_threads());
+    #pragma omp parallel
+    #pragma omp single
+    interact(tree, 0, std::vector<uint32_t>{ 0 }, kernels);
+
+    downwardPass(tree);
+
+    // L2P：叶节点的局部展开在各天体处求梯度，加上近场直接求和的结果
+    const uint32_t* order = tree.order();
+    const double* bx = tree.sortedX();
+    const double* by = tree.sortedY();
+    const double* bz = tree.sortedZ();
+    const double G = params_.gravityConstant;
+    const bool planar = policy.dimensions == 2;
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (ptrdiff_t k = 0; k < static_cast<ptrdiff_t>(nodes); ++k) {
+        const uint32_t node = static_cast<uint32_t>(k);
+        if (!tree.isLeaf(node)) continue;
+        const Vector3D c = tree.centerOfMass(node);
+        const double* l = local_.data() + node * T;
+        double px[kMaxOrder + 1], py[kMaxOrder + 1], pz[kMaxOrder + 1];
+        for (uint32_t i = tree.bodyBegin(node), e = i + tree.bodyCount(node); i < e; ++i) {
+            px[0] = py[0] = pz[0] = 1;
+            for (int q = 1; q <= params_.order; ++q) {
+                px[q] = px[q - 1] * (bx[i] - c.x());
+                py[q] = py[q - 1] * (by[i] - c.y());
+                pz[q] = pz[q - 1] * (bz[i] - c.z());
+            }
+            double gx = 0, gy = 0, gz = 0;
+            for (size_t t = 1; t < T; ++t) {
+                const int x = terms_.index[t][0], y = terms_.index[t][1], z = terms_.index[t][2];
+                if (x > 0) gx += l[t] * x * px[x - 1] * py[y] * pz[z];
+                if (y > 0) gy += l[t] * y * px[x] * py[y - 1] * pz[z];
+                if (z > 0) gz += l[t] * z * px[x] * py[y] * pz[z - 1];
+            }
+            if (planar) gz = 0;
+            const Vector3D a(accX_[i] + G * gx, accY_[i] + G * gy, accZ_[i] + G * gz);
+            const uint32_t body = order[i];
+            store.setAcceleration(body, a);
+            if (kick) kick->apply(body, a.x(), a.y(), a.z());
+        }
+    }
+    nodes_ = nodes;
+}
+
+bool FmmSolver::fieldAt(const LinearOctree& tree, const Vector3D& position, Vector3D& field) const {
+    if (nodes_ == 0 || nodes_ != tree.nodeCount()) return false;
+    const size_t T = terms_.size();
+    const double* bx = tree.sortedX();
+    const double* by = tree.sortedY();
+    const double* bz = tree.sortedZ();
+    const double* bm = tree.sortedMass();
+    const double* br = tree.sortedRadius();
+    double d[kMaxTerms];
+
+    uint32_t stack[7 * LinearOctree::kMaxDepth + 8];
+    int top = 0;
+    stack[top++] = 0;
+    double gx = 0, gy = 0, gz = 0;
+    while (top > 0) {
+        const uint32_t node = stack[--top];
+        const Vector3D r = position - tree.centerOfMass(node);
+        const double distance = r.magnitude();
+
+        if (radius_[node] < params_.theta * distance) {
+            // M2P：grad phi = sum_k (-1)^|k| M_k D^(k+e_i)(1/r)
+            derivatives(derivTerms_, r.x(), r.y(), r.z(), d);
+            const double* m = multipole_.data() + node * T;
+            for (size_t i = 0; i < T; ++i) {
+                const auto& k = terms_.index[i];
+                const double sign = terms_.sign[i];
+                gx += sign * m[i] * d[derivTerms_.at(k[0] + 1, k[1], k[2])];
+                gy += sign * m[i] * d[derivTerms_.at(k[0], k[1] + 1, k[2])];
+                gz += sign * m[i] * d[derivTerms_.at(k[0], k[1], k[2] + 1)];
+            }
+            continue;
+        }
+
+        if (!tree.isLeaf(node)) {
+            for (uint32_t ch = tree.firstChild(node), e = ch + tree.childCount(node); ch < e; ++ch) {
+                stack[top++] = ch;
+            }
+            continue;
+        }
+
+        // 近处叶节点直接求和，天体内部的点不计该天体
+        for (uint32_t j = tree.bodyBegin(node), e = j + tree.bodyCount(node); j < e; ++j) {
+            const double dx = bx[j] - position.x();
+            const double dy = by[j] - position.y();
+            const double dz = bz[j] - position.z();
+            const double d2 = dx * dx + dy * dy + dz * dz;
+            if (d2 <= br[j] * br[j]) continue;
+            const double s = bm[j] / (d2 * std::sqrt(d2));
+            gx += dx * s;
+            gy += dy * s;
+            gz += dz * s;
+        }
+    }
+    field = Vector3D(gx, gy, gz) * params_.gravityConstant;
+    return true;
+}
+
+nlohmann::json FmmSolver::toJson() const {
+    return {
+        {"order", params_.order},
+        {"theta", params_.theta},
+        {"terms", terms_.size()},
+        {"nodes", nodes_},
+        {"m2l", m2lCount_},
+        {"p2pPairs", p2pPairs_}
+    };
+}
+
+} // namespace GEngine
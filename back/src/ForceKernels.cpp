@@ -0,0 +1,257 @@
+#include "../include/ForceKernels.hpp"
+#include "../include/ForcePolicies.hpp"
+#include "../include/Config.hpp"
+#include "../include/Hardware.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace GEngine {
+
+namespace detail {
+void kernelTableScalar(KernelSet (&table)[kPolicyCount]);
+#if defined(GENGINE_X86_SIMD)
+void kernelTableAvx2(KernelSet (&table)[kPolicyCount]);
+void kernelTableAvx512(KernelSet (&table)[kPolicyCount]);
+#endif
+} // namespace detail
+
+namespace {
+
+// 单精度坐标暂存区
+struct FloatBuffer {
+    std::vector<float> x, y, z, gm, radius;
+    std::vector<float> xlo, ylo, zlo;  // split时坐标的低位部分
+
+    // 把全部n个天体相对origin转换为单精度；split为true时坐标拆成 hi + lo 两个float
+    void pack(const DirectSumArgs& a, size_t n, const double origin[3], bool split) {
+        x.resize(n); y.resize(n); z.resize(n);
+        gm.resize(n); radius.resize(n);
+        if (split) {
+            xlo.resize(n); ylo.resize(n); zlo.resize(n);
+        }
+        #pragma omp parallel for schedule(static)
+        for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(n); ++i) {
+            double dx = a.x[i] - origin[0];
+            double dy = a.y[i] - origin[1];
+            double dz = a.z[i] - origin[2];
+            x[i] = static_cast<float>(dx);
+            y[i] = static_cast<float>(dy);
+            z[i] = static_cast<float>(dz);
+            if (split) {
+                xlo[i] = static_cast<float>(dx - x[i]);
+                ylo[i] = static_cast<float>(dy - y[i]);
+                zlo[i] = static_cast<float>(dz - z[i]);
+            }
+            gm[i] = static_cast<float>(a.gravityConstant * a.mass[i]);
+            radius[i] = static_cast<float>(a.radius[i]);
+        }
+    }
+
+    FloatSources sources(size_t offset, size_t count) const {
+        FloatSources s{ x.data() + offset, y.data() + offset, z.data() + offset,
+                        gm.data() + offset, radius.data() + offset, count };
+        if (!xlo.empty()) {
+            s.xlo = xlo.data() + offset;
+            s.ylo = ylo.data() + offset;
+            s.zlo = zlo.data() + offset;
+        }
+        return s;
+    }
+
+    FloatTargets targets(size_t offset, size_t count, double* ax, double* ay, double* az) const {
+        FloatTargets t{ x.data() + offset, y.data() + offset, z.data() + offset,
+                        radius.data() + offset, count, ax, ay, az };
+        if (!xlo.empty()) {
+            t.xlo = xlo.data() + offset;
+            t.ylo = ylo.data() + offset;
+            t.zlo = zlo.data() + offset;
+        }
+        return t;
+    }
+};
+
+// 全部天体包围盒的中心
+void boundsCenter(const DirectSumArgs& a, size_t n, double origin[3]) {
+    double lo[3] = { a.x[0], a.y[0], a.z[0] };
+    double hi[3] = { lo[0], lo[1], lo[2] };
+    for (size_t i = 1; i < n; ++i) {
+        lo[0] = std::min(lo[0], a.x[i]); hi[0] = std::max(hi[0], a.x[i]);
+        lo[1] = std::min(lo[1], a.y[i]); hi[1] = std::max(hi[1], a.y[i]);
+        lo[2] = std::min(lo[2], a.z[i]); hi[2] = std::max(hi[2], a.z[i]);
+    }
+    for (int k = 0; k < 3; ++k) origin[k] = 0.5 * (lo[k] + hi[k]);
+}
+
+// 目标块[i0, i1)的加速度已是最终值，趁其仍在缓存中做速度kick
+void kickBlock(const VelocityKick& kick, const DirectSumArgs& a, size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+        kick.apply(i, a.ax[i], a.ay[i], a.az[i]);
+    }
+}
+
+} // namespace
+
+namespace ForceKernels {
+
+SimdLevel detectSimdLevel() {
+    static const SimdLevel level = [] {
+#if defined(GENGINE_X86_SIMD)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+#endif
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+SimdLevel activeSimdLevel() {
+    SimdLevel requested = parseSimdLevel(SimulationConfig::getInstance().simdLevel);
+    SimdLevel available = detectSimdLevel();
+    return static_cast<int>(requested) < static_cast<int>(available) ? requested : available;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return "avx512";
+        case SimdLevel::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+SimdLevel parseSimdLevel(const std::string& name) {
+    if (name == "scalar") return SimdLevel::Scalar;
+    if (name == "avx2") return SimdLevel::AVX2;
+    return SimdLevel::AVX512;  // "auto"及"avx512"：取可用的最高级别
+}
+
+ForcePrecision activePrecision() {
+    return parsePrecision(SimulationConfig::getInstance().forcePrecision);
+}
+
+const char* precisionName(ForcePrecision precision) {
+    switch (precision) {
+        case ForcePrecision::Mixed: return "mixed";
+        case ForcePrecision::Float: return "float";
+        default: return "double";
+    }
+}
+
+ForcePrecision parsePrecision(const std::string& name) {
+    if (name == "mixed") return ForcePrecision::Mixed;
+    if (name == "float") return ForcePrecision::Float;
+    return ForcePrecision::Double;
+}
+
+KernelPolicy activePolicy() {
+    const auto& config = SimulationConfig::getInstance();
+    KernelPolicy policy;
+    policy.softening = parseSoftening(config.softening);
+    policy.collisionExclusion = config.collisionExclusion;
+    policy.dimensions = config.dimensions == 2 ? 2 : 3;
+    return policy;
+}
+
+SofteningLaw parseSoftening(const std::string& name) {
+    return name == "plummer" ? SofteningLaw::Plummer : SofteningLaw::None;
+}
+
+const KernelSet& selectKernels(SimdLevel level, const KernelPolicy& policy) {
+    // 每种SIMD级别一张表，表项是按策略完全特化的核函数
+    struct Tables {
+        KernelSet scalar[kPolicyCount];
+        KernelSet avx2[kPolicyCount];
+        KernelSet avx512[kPolicyCount];
+        Tables() {
+            detail::kernelTableScalar(scalar);
+#if defined(GENGINE_X86_SIMD)
+            detail::kernelTableAvx2(avx2);
+            detail::kernelTableAvx512(avx512);
+#else
+            detail::kernelTableScalar(avx2);
+            detail::kernelTableScalar(avx512);
+#endif
+        }
+    };
+    static const Tables tables;
+
+    const size_t index = policyIndex(policy);
+    switch (level) {
+        case SimdLevel::AVX512: return tables.avx512[index];
+        case SimdLevel::AVX2: return tables.avx2[index];
+        default: return tables.scalar[index];
+    }
+}
+
+void directSumAll(const KernelSet& kernels, ForcePrecision precision,
+                  const DirectSumArgs& args, size_t n, size_t sourceTile,
+                  const VelocityKick* kick, const std::vector<DirectSumArgs>* nodeArgs) {
+    // 不分块时目标块只用于划分并行任务；分块时目标块越大，源块被复用的次数越多
+    const size_t targetBlock = sourceTile > 0 && sourceTile < n ? 256 : 64;
+    const size_t tile = sourceTile > 0 && sourceTile < n ? sourceTile : n;
+    const ptrdiff_t blocks = static_cast<ptrdiff_t>((n + targetBlock - 1) / targetBlock);
+
+    if (precision == ForcePrecision::Double) {
+        #pragma omp parallel
+        {
+            // 源天体读本节点副本，加速度写回共享数组
+            const DirectSumArgs& local = nodeArgs && !nodeArgs->empty()
+                ? (*nodeArgs)[std::min<size_t>(Hardware::currentNumaNode(), nodeArgs->size() - 1)]
+                : args;
+            #pragma omp for schedule(static)
+            for (ptrdiff_t b = 0; b < blocks; ++b) {
+                size_t i0 = static_cast<size_t>(b) * targetBlock;
+                size_t i1 = std::min(n, i0 + targetBlock);
+                std::fill(args.ax + i0, args.ax + i1, 0.0);
+                std::fill(args.ay + i0, args.ay + i1, 0.0);
+                std::fill(args.az + i0, args.az + i1, 0.0);
+                for (size_t j0 = 0; j0 < n; j0 += tile) {
+                    kernels.directSum(local, i0, i1, j0, std::min(n, j0 + tile));
+                }
+                if (kick) kickBlock(*kick, args, i0, i1);
+            }
+        }
+        return;
+    }
+
+    // 每步一次性把全部坐标转换为单精度。
+    // Float模式直接转换；Mixed模式先平移到包围盒中心，再拆成 hi + lo 两个float，
+    // 位移按 (hi_j - hi_i) + (lo_j - lo_i) 计算：相近天体的hi相减没有舍入，
+    // 误差只与天体间距成比例，不会因为太阳系尺度（1e12 m）的绝对坐标而丢失精度。
+    const bool split = precision == ForcePrecision::Mixed;
+    double origin[3] = { 0, 0, 0 };
+    if (split && n > 0) {
+        boundsCenter(args, n, origin);
+    }
+    FloatBuffer packed;
+    packed.pack(args, n, origin, split);
+    const DirectSumFloatFn floatKernel = split ? kernels.directSumSplit : kernels.directSumFloat;
+
+    #pragma omp parallel for schedule(static)
+    for (ptrdiff_t b = 0; b < blocks; ++b) {
+        size_t i0 = static_cast<size_t>(b) * targetBlock;
+        size_t i1 = std::min(n, i0 + targetBlock);
+        std::fill(args.ax + i0, args.ax + i1, 0.0);
+        std::fill(args.ay + i0, args.ay + i1, 0.0);
+        std::fill(args.az + i0, args.az + i1, 0.0);
+        FloatTargets targets = packed.targets(i0, i1 - i0, args.ax + i0, args.ay + i0, args.az + i0);
+        for (size_t j0 = 0; j0 < n; j0 += tile) {
+            size_t j1 = std::min(n, j0 + tile);
+            FloatSources sources = packed.sources(j0, j1 - j0);
+            sources.softening2 = static_cast<float>(args.softening2);
+            floatKernel(sources, targets);
+        }
+        if (kick) kickBlock(*kick, args, i0, i1);
+    }
+}
+
+size_t autoSourceTile() {
+    const size_t bytesPerSource = 5 * sizeof(double);
+    size_t tile = Hardware::l1DataCacheSize() / 2 / bytesPerSource;
+    return std::max<size_t>(64, tile / 16 * 16);
+}
+
+} // namespace ForceKernels
+
+} // namespace GEngine
@@ -0,0 +1,117 @@
+#include "../include/Hardware.hpp"
+#include <algorithm>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#endif
+#include <thread>
+
+namespace GEngine {
+
+namespace {
+
+size_t queryCacheSize(int level, size_t fallback) {
+    long bytes = 0;
+#if defined(__APPLE__)
+    const char* key = level == 1 ? "hw.l1dcachesize" : "hw.l2cachesize";
+    int64_t value = 0;
+    size_t len = sizeof(value);
+    if (sysctlbyname(key, &value, &len, nullptr, 0) == 0) bytes = static_cast<long>(value);
+#elif defined(__linux__) && defined(_SC_LEVEL1_DCACHE_SIZE)
+    bytes = sysconf(level == 1 ? _SC_LEVEL1_DCACHE_SIZE : _SC_LEVEL2_CACHE_SIZE);
+#endif
+    return bytes > 0 ? static_cast<size_t>(bytes) : fallback;
+}
+
+#if defined(__linux__)
+// 解析 "0-3,8-11" 形式的CPU（或节点）列表
+std::vector<int> parseCpuList(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream ss(text);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) continue;
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+#endif
+
+std::vector<Hardware::NumaNode> queryNumaNodes() {
+    std::vector<Hardware::NumaNode> nodes;
+#if defined(__linux__)
+    // 在线节点的编号列表，格式与CPU列表相同；不连续的编号逐个读取，只有内存的节点没有CPU，跳过
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string text;
+    if (online && std::getline(online, text)) {
+        for (int id : parseCpuList(text)) {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string list;
+            if (!in || !std::getline(in, list)) continue;
+            std::vector<int> cpus = parseCpuList(list);
+            if (!cpus.empty()) nodes.push_back(Hardware::NumaNode{ id, std::move(cpus) });
+        }
+    }
+#endif
+    if (nodes.empty()) {
+        std::vector<int> all;
+        unsigned count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned cpu = 0; cpu < count; ++cpu) all.push_back(static_cast<int>(cpu));
+        nodes.push_back(Hardware::NumaNode{ 0, std::move(all) });
+    }
+    return nodes;
+}
+
+} // namespace
+
+namespace Hardware {
+
+size_t l1DataCacheSize() {
+    static const size_t size = queryCacheSize(1, 32 * 1024);
+    return size;
+}
+
+size_t l2CacheSize() {
+    static const size_t size = queryCacheSize(2, 256 * 1024);
+    return size;
+}
+
+const std::vector<NumaNode>& numaNodes() {
+    static const std::vector<NumaNode> nodes = queryNumaNodes();
+    return nodes;
+}
+
+int numaNodeOfCpu(int cpu) {
+    static const std::vector<int> nodeOfCpu = [] {
+        std::vector<int> map;
+        const auto& nodes = numaNodes();
+        for (size_t node = 0; node < nodes.size(); ++node) {
+            for (int c : nodes[node].cpus) {
+                if (c >= static_cast<int>(map.size())) map.resize(c + 1, 0);
+                map[c] = static_cast<int>(node);
+            }
+        }
+        return map;
+    }();
+    return cpu >= 0 && cpu < static_cast<int>(nodeOfCpu.size()) ? nodeOfCpu[cpu] : 0;
+}
+
+int currentNumaNode() {
+#if defined(__linux__)
+    if (numaNodes().size() > 1) return numaNodeOfCpu(sched_getcpu());
+#endif
+    return 0;
+}
+
+} // namespace Hardware
+
+} // namespace GEngine
@@ -0,0 +1,211 @@
+#include "../include/Integrator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+namespace GEngine {
+
+nlohmann::json IIntegrator::toJson() const {
+    return {
+        {"name", name()},
+        {"forceEvaluations", forceEvaluations_}
+    };
+}
+
+void LeapfrogIntegrator::step(BodyStore& store, double dt, const ForceFunction& forces) {
+    // 前半步kick + drift；新位置上求力，写出时顺带完成后半步kick
+    store.kickDrift(dt);
+    const VelocityKick kick = store.closingKick(dt);
+    forces(&kick);
+    forceEvaluations_ = 1;
+}
+
+void Yoshida4Integrator::step(BodyStore& store, double dt, const ForceFunction& forces) {
+    const double cbrt2 = std::cbrt(2.0);
+    const double w1 = 1 / (2 - cbrt2);
+    const double w0 = 1 - 2 * w1;
+    for (const double w : { w1, w0, w1 }) {
+        store.kickDrift(w * dt);
+        const VelocityKick kick = store.closingKick(w * dt);
+        forces(&kick);
+    }
+    forceEvaluations_ = 3;
+}
+
+namespace {
+
+// Dormand-Prince 5(4) 系数。第7级的系数即五阶解的权重，其位置就是子步终点
+constexpr double kA[7][6] = {
+    { 0, 0, 0, 0, 0, 0 },
+    { 1.0 / 5, 0, 0, 0, 0, 0 },
+    { 3.0 / 40, 9.0 / 40, 0, 0, 0, 0 },
+    { 44.0 / 45, -56.0 / 15, 32.0 / 9, 0, 0, 0 },
+    { 19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729, 0, 0 },
+    { 9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656, 0 },
+    { 35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84 }
+};
+// 五阶解与四阶解之差的权重，用于误差估计
+constexpr double kE[7] = {
+    71.0 / 57600, 0, -71.0 / 16695, 71.0 / 1920, -17253.0 / 339200, 22.0 / 525, -1.0 / 40
+};
+
+// 步长调整的安全系数和每次调整的倍数范围
+constexpr double kSafety = 0.9;
+constexpr double kMinFactor = 0.2;
+constexpr double kMaxFactor = 5.0;
+
+} // namespace
+
+void Rk45Integrator::writeStage(BodyStore& store, double h, const double* coef, int count) {
+    const ptrdiff_t n = static_cast<ptrdiff_t>(store.size());
+    double* out[6] = { store.px(), store.py(), store.pz(), store.vx(), store.vy(), store.vz() };
+    #pragma omp parallel for schedule(static)
+    for (ptrdiff_t i = 0; i < n; ++i) {
+        for (int c = 0; c < 6; ++c) {
+            const size_t k = c * n + i;
+            double sum = 0;
+            for (int j = 0; j < count; ++j) sum += coef[j] * stages_[j][k];
+            out[c][i] = start_[k] + h * sum;
+        }
+    }
+}
+
+void Rk45Integrator::readDerivative(const BodyStore& store, int s) {
+    const ptrdiff_t n = static_cast<ptrdiff_t>(store.size());
+    const double* in[6] = { store.vx(), store.vy(), store.vz(), store.ax(), store.ay(), store.az() };
+    double* stage = stages_[s].data();
+    #pragma omp parallel for schedule(static)
+    for (ptrdiff_t i = 0; i < n; ++i) {
+        for (int c = 0; c < 6; ++c) stage[c * n + i] = in[c][i];
+    }
+}
+
+void Rk45Integrator::step(BodyStore& store, double dt, const ForceFunction& forces) {
+    forceEvaluations_ = 0;
+    substeps_ = 0;
+    rejected_ = 0;
+    const ptrdiff_t n = static_cast<ptrdiff_t>(store.size());
+    if (n == 0 || dt == 0) return;
+    if (store.layoutRevision() != layout_) {
+        stepSize_ = 0;
+        layout_ = store.layoutRevision();
+    }
+
+    const size_t total = 6 * static_cast<size_t>(n);
+    start_.resize(total);
+    result_.resize(total);
+    for (auto& stage : stages_) stage.resize(total);
+
+    double* state[6] = { store.px(), store.py(), store.pz(), store.vx(), store.vy(), store.vz() };
+    auto save = [&](std::vector<double>& into) {
+        #pragma omp parallel for schedule(static)
+        for (ptrdiff_t i = 0; i < n; ++i) {
+            for (int c = 0; c < 6; ++c) into[c * n + i] = state[c][i];
+        }
+    };
+    // 第一级导数：进入时的速度和加速度
+    save(start_);
+    readDerivative(store, 0);
+
+    const double direction = dt > 0 ? 1.0 : -1.0;
+    double remaining = std::abs(dt);
+    double h = stepSize_ > 0 ? stepSize_ : remaining;
+    while (remaining > 0) {
+        // 剩余时间不超过建议步长（含舍入）时一步走完
+        const double proposed = h;
+        const bool final = proposed >= remaining * (1 - 1e-12);
+        h = final ? remaining : proposed;
+        const double signedH = direction * h;
+
+        for (int s = 1; s < kStages; ++s) {
+            writeStage(store, signedH, kA[s], s);
+            forces(nullptr);
+            ++forceEvaluations_;
+            readDerivative(store, s);
+        }
+        save(result_);
+
+        // 误差范数：各分量的尺度为 |y| 加上同类分量（位置或速度）的均方根
+        double rms[2] = { 0, 0 };
+        #pragma omp parallel for schedule(static) reduction(+:rms[:2])
+        for (ptrdiff_t i = 0; i < n; ++i) {
+            for (int c = 0; c < 6; ++c) rms[c / 3] += start_[c * n + i] * start_[c * n + i];
+        }
+        rms[0] = std::sqrt(rms[0] / (3 * n));
+        rms[1] = std::sqrt(rms[1] / (3 * n));
+
+        double sum = 0;
+        #pragma omp parallel for schedule(static) reduction(+:sum)
+        for (ptrdiff_t i = 0; i < n; ++i) {
+            for (int c = 0; c < 6; ++c) {
+                const size_t k = c * n + i;
+                double e = 0;
+                for (int j = 0; j < kStages; ++j) e += kE[j] * stages_[j][k];
+                e *= signedH;
+                const double scale = tolerance_ * (std::max(std::abs(start_[k]), std::abs(result_[k])) + rms[c / 3])
+                                   + std::numeric_limits<double>::min();
+                sum += (e / scale) * (e / scale);
+            }
+        }
+        const double error = std::sqrt(sum / total);
+        const double factor = error > 0
+            ? std::clamp(kSafety * std::pow(error, -0.2), kMinFactor, kMaxFactor)
+            : kMaxFactor;
+
+        if (error <= 1) {
+            // 接受：store已是子步终点的状态，最后一级即新位置上的加速度
+            ++substeps_;
+            remaining = final ? 0 : remaining - h;
+            start_.swap(result_);
+            stages_[0].swap(stages_[kStages - 1]);
+            // 被剩余时间截短的子步不代表误差允许的步长，建议步长不因此缩小
+            stepSize_ = h < proposed ? std::max(proposed, h * factor) : h * factor;
+            h = stepSize_;
+        } else {
+            // 拒绝：恢复子步起点的位置、速度和加速度，缩小步长重试
+            ++rejected_;
+            double* accel[3] = { store.ax(), store.ay(), store.az() };
+            #pragma omp parallel for schedule(static)
+            for (ptrdiff_t i = 0; i < n; ++i) {
+                for (int c = 0; c < 6; ++c) state[c][i] = start_[c * n + i];
+                for (int c = 0; c < 3; ++c) accel[c][i] = stages_[0][(c + 3) * n + i];
+            }
+            h *= factor;
+        }
+        if (substeps_ + rejected_ > kMaxSubsteps || !(h > std::abs(dt) * 1e-14)) {
+            throw std::runtime_error("rk45: step size underflow, tolerance cannot be met");
+        }
+    }
+}
+
+nlohmann::json Rk45Integrator::toJson() const {
+    nlohmann::json json = IIntegrator::toJson();
+    json["tolerance"] = tolerance_;
+    json["substeps"] = substeps_;
+    json["rejected"] = rejected_;
+    json["stepSize"] = stepSize_;
+    return json;
+}
+
+namespace Integrators {
+
+std::unique_ptr<IIntegrator> create(const std::string& name, double tolerance) {
+    if (name == "yoshida4") return std::make_unique<Yoshida4Integrator>();
+    if (name == "rk45") return std::make_unique<Rk45Integrator>(tolerance);
+    return std::make_unique<LeapfrogIntegrator>();
+}
+
+void select(std::unique_ptr<IIntegrator>& current, const std::string& name, double tolerance) {
+    const std::string wanted = name == "yoshida4" || name == "rk45" ? name : "leapfrog";
+    if (!current || wanted != current->name()) {
+        current = create(wanted, tolerance);
+    } else if (auto* rk45 = dynamic_cast<Rk45Integrator*>(current.get())) {
+        rk45->setTolerance(tolerance);
+    }
+}
+
+} // namespace Integrators
+
+} // namespace GEngine
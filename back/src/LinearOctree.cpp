@@ -0,0 +1,944 @@
+#include "../include/LinearOctree.hpp"
+#include "../include/ForcePolicies.hpp"
+#include "../include/Morton.hpp"
+#include "kernels/DirectSumKernel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <omp.h>
+#include <type_traits>
+
+namespace GEngine {
+
+void RootCube::update(const BodyStore& store, double padding, double hysteresis) {
+    Vector3D lo, hi;
+    if (!store.bounds(lo, hi)) {
+        valid = false;
+        return;
+    }
+    const double extent = std::max({ hi.x() - lo.x(), hi.y() - lo.y(), hi.z() - lo.z() }) / 2;
+
+    if (valid && hysteresis > 0 && extent >= hysteresis * halfSize
+        && lo.x() >= center.x() - halfSize && hi.x() < center.x() + halfSize
+        && lo.y() >= center.y() - halfSize && hi.y() < center.y() + halfSize
+        && lo.z() >= center.z() - halfSize && hi.z() < center.z() + halfSize) {
+        return;
+    }
+
+    center = (lo + hi) * 0.5;
+    halfSize = extent * (1 + padding);
+    // 单个天体或全部重合时给一个非零尺寸
+    if (!(halfSize > 0)) halfSize = std::max(1.0, center.magnitude() * 1e-9);
+    valid = true;
+    ++refits;
+}
+
+nlohmann::json RootCube::toJson() const {
+    return {
+        {"center", {center.x(), center.y(), center.z()}},
+        {"halfSize", halfSize},
+        {"refits", refits}
+    };
+}
+
+void LinearOctree::clear() {
+    nodeCount_ = 0;
+    levelStart_.clear();
+    stats_.nodes = 0;
+    stats_.bytesInUse = 0;
+}
+
+void LinearOctree::reserveNodes(size_t nodes) {
+    if (nodes <= nodeCapacity_) return;
+    if (nodeCapacity_ > 0) ++stats_.growths;
+    nodeCapacity_ = std::max(nodes, nodeCapacity_ * 2);
+    // resize不初始化新元素，已有节点保留
+    for (auto* array : { &centerX_, &centerY_, &centerZ_, &halfSize_, &mass_, &comX_, &comY_, &comZ_,
+                         &qxx_, &qxy_, &qxz_, &qyy_, &qyz_, &qzz_, &bmax_, &rmax_ }) {
+        array->resize(nodeCapacity_);
+    }
+    firstChild_.resize(nodeCapacity_);
+    childCount_.resize(nodeCapacity_);
+    bodyBegin_.resize(nodeCapacity_);
+    bodyCount_.resize(nodeCapacity_);
+}
+
+uint32_t LinearOctree::appendNode(double cx, double cy, double cz, double half,
+                                  uint32_t begin, uint32_t count) {
+    reserveNodes(nodeCount_ + 1);
+    const uint32_t k = static_cast<uint32_t>(nodeCount_++);
+    setNode(k, cx, cy, cz, half, begin, count);
+    return k;
+}
+
+void LinearOctree::setNode(uint32_t k, double cx, double cy, double cz, double half,
+                           uint32_t begin, uint32_t count) {
+    centerX_[k] = cx; centerY_[k] = cy; centerZ_[k] = cz;
+    halfSize_[k] = half;
+    mass_[k] = 0; comX_[k] = 0; comY_[k] = 0; comZ_[k] = 0;
+    firstChild_[k] = kNoChild;
+    childCount_[k] = 0;
+    bodyBegin_[k] = begin;
+    bodyCount_[k] = count;
+}
+
+void LinearOctree::updateMemoryStats() {
+    const size_t bodyBytes = sizeof(uint32_t) + 2 * sizeof(uint64_t) + 5 * sizeof(double);
+    stats_.nodes = nodeCount_;
+    stats_.nodeCapacity = nodeCapacity_;
+    stats_.bytesInUse = nodeCount_ * kBytesPerNode + order_.size() * bodyBytes;
+    stats_.bytesReserved = nodeCapacity_ * kBytesPerNode
+                         + (order_.capacity() + scratchOrder_.capacity()) * sizeof(uint32_t)
+                         + (keys_.capacity() + scratchKeys_.capacity()) * sizeof(uint64_t)
+                         + bodyX_.capacity() * 5 * sizeof(double);
+    stats_.highWaterNodes = std::max(stats_.highWaterNodes, nodeCount_);
+    stats_.highWaterBytes = std::max(stats_.highWaterBytes, stats_.bytesInUse);
+}
+
+namespace {
+
+// 并行建树的最小规模，更小的树串行构建更快
+constexpr size_t kParallelBuildThreshold = 8192;
+
+// 并行LSD基数排序：每趟8位，各线程先统计本段直方图，再按（数字, 线程）顺序求出写入位置。
+// 排序是稳定的，键相同的天体保持下标顺序，因此结果与线程数无关。
+// 输入keys/order，结果写回keys/order，tmpKeys/tmpOrder为同样大小的暂存区。
+void radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& order,
+               std::vector<uint64_t>& tmpKeys, std::vector<uint32_t>& tmpOrder,
+               std::vector<size_t>& counts) {
+    const size_t n = keys.size();
+    tmpKeys.resize(n);
+    tmpOrder.resize(n);
+    const bool parallel = n >= kParallelBuildThreshold;
+    const int threads = parallel ? omp_get_max_threads() : 1;
+    counts.assign(static_cast<size_t>(threads) * 256, 0);
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        bool skip = false;
+        #pragma omp parallel num_threads(threads) if(parallel)
+        {
+            const int t = omp_get_thread_num();
+            const int used = omp_get_num_threads();
+            const size_t begin = n * t / used;
+            const size_t end = n * (t + 1) / used;
+            size_t* local = counts.data() + static_cast<size_t>(t) * 256;
+            std::fill(local, local + 256, 0);
+            for (size_t i = begin; i < end; ++i) ++local[(keys[i] >> shift) & 0xff];
+            #pragma omp barrier
+
+            #pragma omp single
+            {
+                // 所有键在这一趟的数字相同时跳过
+                for (int d = 0; d < 256 && !skip; ++d) {
+                    size_t total = 0;
+                    for (int u = 0; u < used; ++u) total += counts[static_cast<size_t>(u) * 256 + d];
+                    skip = total == n;
+                }
+                if (!skip) {
+                    size_t offset = 0;
+                    for (int d = 0; d < 256; ++d) {
+                        for (int u = 0; u < used; ++u) {
+                            size_t c = counts[static_cast<size_t>(u) * 256 + d];
+                            counts[static_cast<size_t>(u) * 256 + d] = offset;
+                            offset += c;
+                        }
+                    }
+                }
+            }
+
+            if (!skip) {
+                for (size_t i = begin; i < end; ++i) {
+                    size_t pos = local[(keys[i] >> shift) & 0xff]++;
+                    tmpKeys[pos] = keys[i];
+                    tmpOrder[pos] = order[i];
+                }
+            }
+        }
+        if (!skip) {
+            keys.swap(tmpKeys);
+            order.swap(tmpOrder);
+        }
+    }
+}
+
+} // namespace
+
+void LinearOctree::build(const BodyStore& store, const Vector3D& center, double halfSize,
+                         const TreeBuildParams& params) {
+    // 按上一步的节点数预留（首次按天体数的2倍估计），正常情况下建树过程中不再分配
+    const size_t n = store.size();
+    const size_t previous = lastBuildNodes_;
+    clear();
+    if (n == 0) {
+        updateMemoryStats();
+        return;
+    }
+    leafCapacity_ = std::max<size_t>(1, params.leafCapacity);
+    quadrupole_ = params.quadrupole;
+    groupSize_ = params.groupSize;
+    reserveNodes(previous > 0 ? previous + previous / 8 : 2 * n / leafCapacity_ + 1);
+    const bool parallel = n >= kParallelBuildThreshold;
+
+    // 1. Morton键：根立方体 [center - halfSize, center + halfSize) 划分为 2^21 格
+    const double lo[3] = { center.x() - halfSize, center.y() - halfSize, center.z() - halfSize };
+    const double invCell = Morton::kCellsPerAxis / (2 * halfSize);
+    const double* px = store.px();
+    const double* py = store.py();
+    const double* pz = store.pz();
+    keys_.resize(n);
+    order_.resize(n);
+    #pragma omp parallel for schedule(static) if(parallel)
+    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(n); ++i) {
+        keys_[i] = Morton::encode(Morton::cell(px[i], lo[0], invCell),
+                                  Morton::cell(py[i], lo[1], invCell),
+                                  Morton::cell(pz[i], lo[2], invCell));
+        order_[i] = static_cast<uint32_t>(i);
+    }
+
+    // 2. 按键排序（键相同时按下标）
+    radixSort(keys_, order_, scratchKeys_, scratchOrder_, radixCounts_);
+
+    // 天体数据按排序后的顺序复制一份，叶节点内的天体在这些数组中连续
+    for (auto* array : { &bodyX_, &bodyY_, &bodyZ_, &bodyMass_, &bodyRadius_ }) array->resize(n);
+    const double* mass = store.mass();
+    const double* radius = store.radius();
+    #pragma omp parallel for schedule(static) if(parallel)
+    for (ptrdiff_t k = 0; k < static_cast<ptrdiff_t>(n); ++k) {
+        const uint32_t b = order_[k];
+        bodyX_[k] = px[b];
+        bodyY_[k] = py[b];
+        bodyZ_[k] = pz[b];
+        bodyMass_[k] = mass[b];
+        bodyRadius_[k] = radius[b];
+    }
+
+    // 3. 逐层生成节点：同一层的节点并行切分，子节点按父节点顺序连续排列
+    appendNode(center.x(), center.y(), center.z(), halfSize, 0, static_cast<uint32_t>(n));
+    levelStart_.assign(1, 0);
+    for (int level = 0; nodeCount_ > levelStart_.back(); ++level) {
+        const size_t begin = levelStart_.back();
+        const size_t end = nodeCount_;
+        levelStart_.push_back(end);
+        emitLevel(begin, end, level, parallel);
+    }
+
+    // 4. 自底向上计算质量和质心
+    computeMoments(parallel);
+    collectGroups();
+    lastBuildNodes_ = nodeCount_;
+    rootX_ = center.x();
+    rootY_ = center.y();
+    rootZ_ = center.z();
+    rootHalfSize_ = halfSize;
+    builtLayout_ = store.layoutRevision();
+    ++updateStats_.rebuilds;
+    updateStats_.crossed = 0;
+    updateStats_.overlap = 0;
+    updateMemoryStats();
+}
+
+void LinearOctree::update(const BodyStore& store, const Vector3D& center, double halfSize,
+                          const TreeBuildParams& params, double maxOverlap) {
+    const bool sameTopology = !empty() && order_.size() == store.size()
+        && builtLayout_ == store.layoutRevision()
+        && rootX_ == center.x() && rootY_ == center.y() && rootZ_ == center.z()
+        && rootHalfSize_ == halfSize
+        && leafCapacity_ == std::max<size_t>(1, params.leafCapacity) && quadrupole_ == params.quadrupole
+        && groupSize_ == params.groupSize;
+    if (maxOverlap > 0 && sameTopology && refit(store) <= maxOverlap) {
+        ++updateStats_.refits;
+        return;
+    }
+    build(store, center, halfSize, params);
+}
+
+double LinearOctree::refit(const BodyStore& store) {
+    const size_t n = order_.size();
+    const bool parallel = n >= kParallelBuildThreshold;
+    const double* px = store.px();
+    const double* py = store.py();
+    const double* pz = store.pz();
+    #pragma omp parallel for schedule(static) if(parallel)
+    for (ptrdiff_t k = 0; k < static_cast<ptrdiff_t>(n); ++k) {
+        const uint32_t b = order_[k];
+        bodyX_[k] = px[b];
+        bodyY_[k] = py[b];
+        bodyZ_[k] = pz[b];
+    }
+
+    // 节点边界：以格子中心为中心、包含全部天体（或子节点边界）的立方体，不小于格子本身
+    size_t crossed = 0;
+    double overlap = 0;
+    for (size_t level = levelStart_.size() - 1; level-- > 0;) {
+        const ptrdiff_t begin = static_cast<ptrdiff_t>(levelStart_[level]);
+        const ptrdiff_t end = static_cast<ptrdiff_t>(levelStart_[level + 1]);
+        const double cellHalf = std::ldexp(rootHalfSize_, -static_cast<int>(level));
+        #pragma omp parallel for schedule(static) reduction(+:crossed) reduction(max:overlap) \
+            if(parallel && end - begin > 64)
+        for (ptrdiff_t k = begin; k < end; ++k) {
+            const double cx = centerX_[k], cy = centerY_[k], cz = centerZ_[k];
+            double extent = 0;
+            if (childCount_[k] == 0) {
+                for (uint32_t i = bodyBegin_[k], e = i + bodyCount_[k]; i < e; ++i) {
+                    const double d = std::max({ std::abs(bodyX_[i] - cx), std::abs(bodyY_[i] - cy),
+                                                std::abs(bodyZ_[i] - cz) });
+                    if (d > cellHalf) ++crossed;
+                    extent = std::max(extent, d);
+                }
+            } else {
+                for (uint32_t c = firstChild_[k], e = c + childCount_[k]; c < e; ++c) {
+                    extent = std::max(extent, halfSize_[c] + std::max({ std::abs(centerX_[c] - cx),
+                                                                        std::abs(centerY_[c] - cy),
+                                                                        std::abs(centerZ_[c] - cz) }));
+                }
+            }
+            halfSize_[k] = std::max(cellHalf, extent);
+            overlap = std::max(overlap, halfSize_[k] / cellHalf - 1);
+        }
+    }
+
+    computeMoments(parallel);
+    updateStats_.crossed = crossed;
+    updateStats_.overlap = overlap;
+    return overlap;
+}
+
+void LinearOctree::emitLevel(size_t begin, size_t end, int level, bool parallel) {
+    const ptrdiff_t count = static_cast<ptrdiff_t>(end - begin);
+    const int shift = 3 * (Morton::kBitsPerAxis - 1 - level);
+    splits_.resize(static_cast<size_t>(count) * 9);
+    childTotals_.resize(static_cast<size_t>(count) + 1);
+
+    // a. 每个节点的卦限边界：节点内的键共享更高位，卦限位单调，可以二分查找
+    #pragma omp parallel for schedule(dynamic, 64) if(parallel)
+    for (ptrdiff_t k = 0; k < count; ++k) {
+        const size_t node = begin + static_cast<size_t>(k);
+        uint32_t* split = splits_.data() + k * 9;
+        const uint32_t b = bodyBegin_[node];
+        const uint32_t e = b + bodyCount_[node];
+        uint32_t children = 0;
+        // 天体数不超过leafCapacity的节点是叶节点；达到最大深度时（坐标重合）叶节点可以超过容量
+        if (bodyCount_[node] > leafCapacity_ && level < kMaxDepth) {
+            split[0] = b;
+            for (int octant = 1; octant < 8; ++octant) {
+                split[octant] = static_cast<uint32_t>(
+                    std::partition_point(keys_.begin() + split[octant - 1], keys_.begin() + e,
+                                         [&](uint64_t key) {
+                                             return static_cast<int>((key >> shift) & 7) < octant;
+                                         }) - keys_.begin());
+            }
+            split[8] = e;
+            for (int octant = 0; octant < 8; ++octant) {
+                if (split[octant + 1] > split[octant]) ++children;
+            }
+        }
+        childTotals_[k] = children;
+    }
+
+    // b. 子节点数的前缀和给出每个节点的第一个子节点位置
+    size_t offset = end;
+    for (ptrdiff_t k = 0; k < count; ++k) {
+        const size_t c = childTotals_[k];
+        childTotals_[k] = static_cast<uint32_t>(offset);
+        offset += c;
+    }
+    reserveNodes(offset);
+    nodeCount_ = offset;
+
+    // c. 写出子节点
+    #pragma omp parallel for schedule(dynamic, 64) if(parallel)
+    for (ptrdiff_t k = 0; k < count; ++k) {
+        const size_t node = begin + static_cast<size_t>(k);
+        const uint32_t* split = splits_.data() + k * 9;
+        const uint32_t first = childTotals_[k];
+        const uint32_t last = k + 1 < count ? childTotals_[k + 1] : static_cast<uint32_t>(offset);
+        firstChild_[node] = first == last ? kNoChild : first;
+        childCount_[node] = static_cast<uint8_t>(last - first);
+        if (first == last) continue;
+
+        const double half = halfSize_[node] / 2;
+        const double cx = centerX_[node], cy = centerY_[node], cz = centerZ_[node];
+        uint32_t c = first;
+        for (int octant = 0; octant < 8; ++octant) {
+            if (split[octant + 1] == split[octant]) continue;
+            setNode(c++, cx + ((octant & 1) ? half : -half),
+                    cy + ((octant & 2) ? half : -half),
+                    cz + ((octant & 4) ? half : -half),
+                    half, split[octant], split[octant + 1] - split[octant]);
+        }
+    }
+}
+
+void LinearOctree::computeMoments(bool parallel) {
+    // 从最深一层向上逐层计算，同一层的节点互不依赖
+    for (size_t level = levelStart_.size() - 1; level-- > 0;) {
+        const ptrdiff_t begin = static_cast<ptrdiff_t>(levelStart_[level]);
+        const ptrdiff_t end = static_cast<ptrdiff_t>(levelStart_[level + 1]);
+        #pragma omp parallel for schedule(static) if(parallel && end - begin > 64)
+        for (ptrdiff_t k = begin; k < end; ++k) {
+            const bool leaf = childCount_[k] == 0;
+            const uint32_t first = leaf ? bodyBegin_[k] : firstChild_[k];
+            const uint32_t last = first + (leaf ? bodyCount_[k] : childCount_[k]);
+            // 叶节点的成员是天体，内部节点的成员是子节点（质量集中在其质心）
+            const double* mx = leaf ? bodyX_.data() : comX_.data();
+            const double* my = leaf ? bodyY_.data() : comY_.data();
+            const double* mz = leaf ? bodyZ_.data() : comZ_.data();
+            const double* mm = leaf ? bodyMass_.data() : mass_.data();
+
+            double total = 0, sx = 0, sy = 0, sz = 0;
+            for (uint32_t i = first; i < last; ++i) {
+                total += mm[i];
+                sx += mm[i] * mx[i];
+                sy += mm[i] * my[i];
+                sz += mm[i] * mz[i];
+            }
+            mass_[k] = total;
+            if (total > 0) {
+                comX_[k] = sx / total;
+                comY_[k] = sy / total;
+                comZ_[k] = sz / total;
+            } else {
+                comX_[k] = centerX_[k];
+                comY_[k] = centerY_[k];
+                comZ_[k] = centerZ_[k];
+            }
+
+            // bmax：叶节点取天体到质心的最大距离，内部节点取子节点的 |质心偏移| + bmax 的最大值
+            double reach = 0;
+            for (uint32_t i = first; i < last; ++i) {
+                const double dx = mx[i] - comX_[k];
+                const double dy = my[i] - comY_[k];
+                const double dz = mz[i] - comZ_[k];
+                reach = std::max(reach, std::sqrt(dx * dx + dy * dy + dz * dz) + (leaf ? 0.0 : bmax_[i]));
+            }
+            bmax_[k] = reach;
+            const double* mr = leaf ? bodyRadius_.data() : rmax_.data();
+            rmax_[k] = first < last ? *std::max_element(mr + first, mr + last) : 0.0;
+            if (!quadrupole_) continue;
+
+            // 关于质心的无迹四极矩 Q_ij = sum m (3 d_i d_j - d^2 delta_ij)，
+            // 子节点的四极矩按平行轴定理平移到本节点质心后相加
+            double xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+            for (uint32_t i = first; i < last; ++i) {
+                const double dx = mx[i] - comX_[k];
+                const double dy = my[i] - comY_[k];
+                const double dz = mz[i] - comZ_[k];
+                const double d2 = dx * dx + dy * dy + dz * dz;
+                xx += mm[i] * (3 * dx * dx - d2);
+                xy += mm[i] * (3 * dx * dy);
+                xz += mm[i] * (3 * dx * dz);
+                yy += mm[i] * (3 * dy * dy - d2);
+                yz += mm[i] * (3 * dy * dz);
+                zz += mm[i] * (3 * dz * dz - d2);
+                if (!leaf) {
+                    xx += qxx_[i]; xy += qxy_[i]; xz += qxz_[i];
+                    yy += qyy_[i]; yz += qyz_[i]; zz += qzz_[i];
+                }
+            }
+            qxx_[k] = xx; qxy_[k] = xy; qxz_[k] = xz;
+            qyy_[k] = yy; qyz_[k] = yz; qzz_[k] = zz;
+        }
+    }
+}
+
+void LinearOctree::collectGroups() {
+    groups_.clear();
+    if (groupSize_ > 1) {
+        // 深度优先、子节点逆序压栈，组按Morton顺序排列
+        uint32_t stack[7 * kMaxDepth + 8];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const uint32_t node = stack[--top];
+            if (childCount_[node] == 0 || bodyCount_[node] <= groupSize_) {
+                groups_.push_back(node);
+                continue;
+            }
+            for (uint32_t c = firstChild_[node] + childCount_[node]; c-- > firstChild_[node];) {
+                stack[top++] = c;
+            }
+        }
+    }
+    groupStart_.clear();
+    if (groups_.empty()) return;
+    for (const uint32_t group : groups_) groupStart_.push_back(bodyBegin_[group]);
+    groupStart_.push_back(bodyBegin_[0] + bodyCount_[0]);
+}
+
+void LinearOctree::InteractionList::clear() {
+    for (auto* array : { &x, &y, &z, &mass, &radius, &qxx, &qxy, &qxz, &qyy, &qyz, &qzz }) array->clear();
+    leaves.clear();
+    nodes = 0;
+}
+
+namespace {
+
+// Relative判据要求目标在节点边界放大此倍数的范围之外，避免质心很远而节点边缘紧贴目标时误接受
+constexpr double kRelativeGuard = 1.2;
+
+} // namespace
+
+bool LinearOctree::accepts(uint32_t node, double distance, const Target& target,
+                           const TreeForceParams& params) const {
+    switch (params.criterion) {
+        case OpeningCriterion::BMax:
+            return bmax_[node] < params.theta * distance;
+        case OpeningCriterion::Relative:
+            if (target.limit > 0) {
+                // 目标包围盒与放大后的节点边界在某一轴上分离
+                const double gap = std::max({ std::abs(target.x - centerX_[node]) - target.hx,
+                                              std::abs(target.y - centerY_[node]) - target.hy,
+                                              std::abs(target.z - centerZ_[node]) - target.hz });
+                if (!(gap > kRelativeGuard * halfSize_[node])) return false;
+                const double l = 2 * halfSize_[node];
+                const double d2 = distance * distance;
+                return quadrupole_ ? mass_[node] * l * l * l <= target.limit * d2 * d2 * distance
+                                   : mass_[node] * l * l <= target.limit * d2 * d2;
+            }
+            break;
+        default:
+            break;
+    }
+    return halfSize_[node] < params.theta * distance;
+}
+
+double LinearOctree::relativeLimit(const BodyStore& store, uint32_t begin, uint32_t end,
+                                   const TreeForceParams& params) const {
+    if (params.criterion != OpeningCriterion::Relative || !(params.gravityConstant > 0)) return 0;
+    double a2 = std::numeric_limits<double>::infinity();
+    for (uint32_t slot = begin; slot < end; ++slot) {
+        const Vector3D a = store.acceleration(order_[slot]);
+        a2 = std::min(a2, a.x() * a.x() + a.y() * a.y() + a.z() * a.z());
+    }
+    return params.errorTolerance * std::sqrt(a2) / params.gravityConstant;
+}
+
+namespace {
+
+// 源（质量gm/G）对目标的引力加速度，天体对是否计入及软化由策略P决定。
+// Double/Mixed精度下位移已在双精度中求得（相当于以目标为局部原点平移），
+// 之后的距离和系数在Real精度下计算；Float精度下坐标先直接转换为单精度再求位移。
+template <class Real, class P>
+Vector3D pointAcceleration(double sx, double sy, double sz, const Vector3D& target, double gm,
+                           double radiusSum, double softening2, bool floatCoordinates) {
+    using S = std::conditional_t<std::is_same_v<Real, double>, detail::ScalarD, detail::ScalarF>;
+    Real dx, dy, dz;
+    if (floatCoordinates) {
+        dx = static_cast<Real>(sx) - static_cast<Real>(target.x());
+        dy = static_cast<Real>(sy) - static_cast<Real>(target.y());
+        dz = static_cast<Real>(sz) - static_cast<Real>(target.z());
+    } else {
+        dx = static_cast<Real>(sx - target.x());
+        dy = static_cast<Real>(sy - target.y());
+        dz = static_cast<Real>(sz - target.z());
+    }
+    if constexpr (P::dimensions == 2) dz = 0;
+    Real s = detail::pairFactor<S, P>(dx, dy, dz, static_cast<Real>(gm),
+                                      static_cast<Real>(radiusSum), static_cast<Real>(softening2));
+    return Vector3D(dx * s, dy * s, dz * s);
+}
+
+} // namespace
+
+Vector3D LinearOctree::quadrupoleAcceleration(uint32_t node, double dx, double dy, double dz,
+                                              double gravityConstant) const {
+    // 四极项的势 -G (r^T Q r) / (2 r^5)，r为质心指向目标的位移（即 -d）：
+    // a = G (5/2 (d^T Q d) d / r^7 - Q d / r^5)，不做软化（只用于被接受的远处节点）
+    const double qdx = qxx_[node] * dx + qxy_[node] * dy + qxz_[node] * dz;
+    const double qdy = qxy_[node] * dx + qyy_[node] * dy + qyz_[node] * dz;
+    const double qdz = qxz_[node] * dx + qyz_[node] * dy + qzz_[node] * dz;
+    const double dqd = dx * qdx + dy * qdy + dz * qdz;
+    const double inv2 = 1 / (dx * dx + dy * dy + dz * dz);
+    const double inv5 = gravityConstant * inv2 * inv2 * std::sqrt(inv2);
+    const double radial = 2.5 * dqd * inv2 * inv5;
+    return Vector3D(radial * dx - inv5 * qdx, radial * dy - inv5 * qdy, radial * dz - inv5 * qdz);
+}
+
+template <class Real, class P>
+Vector3D LinearOctree::accelerationOn(size_t slot, const TreeForceParams& params, double limit,
+                                      const KernelSet& kernels, bool floatCoordinates,
+                                      uint32_t& interactions) const {
+    const Vector3D position(bodyX_[slot], bodyY_[slot], bodyZ_[slot]);
+    const Target target{ position.x(), position.y(), position.z(), 0, 0, 0, limit };
+    const double targetRadius = bodyRadius_[slot];
+    // 叶节点的源天体：排序后的连续数组
+    const DirectSumArgs leafArgs{ bodyX_.data(), bodyY_.data(), bodyZ_.data(),
+                                  bodyMass_.data(), bodyRadius_.data(), nullptr, nullptr, nullptr,
+                                  params.gravityConstant, params.softening2 };
+
+    // 每层最多弹出一个节点、压入八个子节点
+    uint32_t stack[7 * kMaxDepth + 8];
+    int top = 0;
+    stack[top++] = 0;
+
+    Vector3D acc(0, 0, 0);
+    double leafAcc[3] = { 0, 0, 0 };
+    while (top > 0) {
+        const uint32_t node = stack[--top];
+        const double dx = comX_[node] - position.x();
+        const double dy = comY_[node] - position.y();
+        const double dz = comZ_[node] - position.z();
+        const double distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+        // 包含目标自身的节点总是打开（节点的天体在排序数组中连续，按区间判断），
+        // 否则质心近似会把目标自身的质量计入
+        const bool containsTarget = slot - bodyBegin_[node] < bodyCount_[node];
+        if (!containsTarget && accepts(node, distance, target, params)) {
+            // 质心近似不做碰撞排除
+            if (distance > 0) {
+                ++interactions;
+                acc += pointAcceleration<Real, P>(comX_[node], comY_[node], comZ_[node], position,
+                                                  params.gravityConstant * mass_[node], 0.0,
+                                                  params.softening2, floatCoordinates);
+                if (quadrupole_) {
+                    Vector3D q = quadrupoleAcceleration(node, dx, dy, P::dimensions == 3 ? dz : 0.0,
+                                                        params.gravityConstant);
+                    if constexpr (P::dimensions == 2) q = Vector3D(q.x(), q.y(), 0);
+                    acc += q;
+                }
+            }
+            continue;
+        }
+
+        if (childCount_[node] > 0) {
+            for (uint32_t c = firstChild_[node], end = c + childCount_[node]; c < end; ++c) {
+                stack[top++] = c;
+            }
+            continue;
+        }
+
+        // 叶节点内的天体逐个直接求和，目标自身不计入
+        const uint32_t begin = bodyBegin_[node];
+        const uint32_t end = begin + bodyCount_[node];
+        interactions += end - begin - (slot >= begin && slot < end ? 1 : 0);
+        if constexpr (std::is_same_v<Real, double>) {
+            if (!floatCoordinates) {
+                // 双精度：SIMD核函数，自身距离为0被掩码排除
+                kernels.leafSum(leafArgs, begin, end, position.x(), position.y(), position.z(),
+                                targetRadius, leafAcc);
+                continue;
+            }
+        }
+        for (uint32_t j = begin; j < end; ++j) {
+            if (j == slot) continue;
+            acc += pointAcceleration<Real, P>(bodyX_[j], bodyY_[j], bodyZ_[j], position,
+                                              params.gravityConstant * bodyMass_[j],
+                                              targetRadius + bodyRadius_[j],
+                                              params.softening2, floatCoordinates);
+        }
+    }
+    return acc + Vector3D(leafAcc[0], leafAcc[1], leafAcc[2]);
+}
+
+Vector3D LinearOctree::fieldAt(const Vector3D& position, double theta, double gravityConstant,
+                               OpeningCriterion criterion) const {
+    if (empty()) return Vector3D(0, 0, 0);
+    const bool bmax = criterion == OpeningCriterion::BMax;
+    uint32_t stack[7 * kMaxDepth + 8];
+    int top = 0;
+    stack[top++] = 0;
+
+    double fx = 0, fy = 0, fz = 0;
+    while (top > 0) {
+        const uint32_t node = stack[--top];
+        if (!(mass_[node] > 0)) continue;
+        const double dx = comX_[node] - position.x();
+        const double dy = comY_[node] - position.y();
+        const double dz = comZ_[node] - position.z();
+        const double d2 = dx * dx + dy * dy + dz * dz;
+
+        if (d2 > 0 && (bmax ? bmax_[node] : halfSize_[node]) < theta * std::sqrt(d2)) {
+            const double inv = 1 / std::sqrt(d2);
+            const double s = gravityConstant * mass_[node] * inv * inv * inv;
+            fx += dx * s;
+            fy += dy * s;
+            fz += dz * s;
+            if (quadrupole_) {
+                const Vector3D q = quadrupoleAcceleration(node, dx, dy, dz, gravityConstant);
+                fx += q.x();
+                fy += q.y();
+                fz += q.z();
+            }
+            continue;
+        }
+
+        if (childCount_[node] > 0) {
+            for (uint32_t c = firstChild_[node], end = c + childCount_[node]; c < end; ++c) {
+                stack[top++] = c;
+            }
+            continue;
+        }
+        for (uint32_t j = bodyBegin_[node], end = j + bodyCount_[node]; j < end; ++j) {
+            const double bx = bodyX_[j] - position.x();
+            const double by = bodyY_[j] - position.y();
+            const double bz = bodyZ_[j] - position.z();
+            const double r2 = bx * bx + by * by + bz * bz;
+            if (r2 <= bodyRadius_[j] * bodyRadius_[j]) continue;
+            const double inv = 1 / std::sqrt(r2);
+            const double s = gravityConstant * bodyMass_[j] * inv * inv * inv;
+            fx += bx * s;
+            fy += by * s;
+            fz += bz * s;
+        }
+    }
+    return Vector3D(fx, fy, fz);
+}
+
+void LinearOctree::findContacts(std::vector<std::pair<uint32_t, uint32_t>>& pairs) const {
+    pairs.clear();
+    if (empty()) return;
+    const ptrdiff_t n = static_cast<ptrdiff_t>(order_.size());
+    // 节点判据与天体对判据都留出少量余量，最终是否接触由调用方按原公式判断
+    constexpr double kSlack = 1 + 1e-9;
+
+    #pragma omp parallel
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> local;
+        #pragma omp for schedule(dynamic, 256) nowait
+        for (ptrdiff_t slot = 0; slot < n; ++slot) {
+            const double x = bodyX_[slot], y = bodyY_[slot], z = bodyZ_[slot];
+            const double r = bodyRadius_[slot];
+            uint32_t stack[7 * kMaxDepth + 8];
+            int top = 0;
+            stack[top++] = 0;
+            while (top > 0) {
+                const uint32_t node = stack[--top];
+                // 只查找排序后位于slot之后的天体，每对只出现一次
+                if (bodyBegin_[node] + bodyCount_[node] <= static_cast<uint32_t>(slot) + 1) continue;
+                // 节点内天体都在以质心为中心、半径bmax的球内。不用节点立方体：
+                // 不随天体移动调整根立方体时，立方体外的天体被归入边界上的节点，并不在其立方体内
+                const double dx = x - comX_[node], dy = y - comY_[node], dz = z - comZ_[node];
+                const double reach = (r + rmax_[node] + bmax_[node]) * kSlack;
+                if (dx * dx + dy * dy + dz * dz > reach * reach) continue;
+
+                if (childCount_[node] > 0) {
+                    for (uint32_t c = firstChild_[node], end = c + childCount_[node]; c < end; ++c) {
+                        stack[top++] = c;
+                    }
+                    continue;
+                }
+                const uint32_t begin = std::max(bodyBegin_[node], static_cast<uint32_t>(slot) + 1);
+                for (uint32_t j = begin, end = bodyBegin_[node] + bodyCount_[node]; j < end; ++j) {
+                    const double bx = bodyX_[j] - x, by = bodyY_[j] - y, bz = bodyZ_[j] - z;
+                    const double contact = (r + bodyRadius_[j]) * kSlack;
+                    if (bx * bx + by * by + bz * bz <= contact * contact) {
+                        const uint32_t a = order_[slot], b = order_[j];
+                        local.emplace_back(std::min(a, b), std::max(a, b));
+                    }
+                }
+            }
+        }
+        #pragma omp critical
+        pairs.insert(pairs.end(), local.begin(), local.end());
+    }
+    std::sort(pairs.begin(), pairs.end());
+}
+
+template <class Emit>
+uint32_t LinearOctree::walkGroup(uint32_t group, const TreeForceParams& params, double limit,
+                                 const KernelSet& kernels,
+                                 ForcePrecision precision, InteractionList& list, Emit&& emit) const {
+    const uint32_t g0 = bodyBegin_[group];
+    const uint32_t g1 = g0 + bodyCount_[group];
+
+    // 组内天体的包围盒
+    double lo[3] = { bodyX_[g0], bodyY_[g0], bodyZ_[g0] };
+    double hi[3] = { lo[0], lo[1], lo[2] };
+    for (uint32_t i = g0 + 1; i < g1; ++i) {
+        lo[0] = std::min(lo[0], bodyX_[i]); hi[0] = std::max(hi[0], bodyX_[i]);
+        lo[1] = std::min(lo[1], bodyY_[i]); hi[1] = std::max(hi[1], bodyY_[i]);
+        lo[2] = std::min(lo[2], bodyZ_[i]); hi[2] = std::max(hi[2], bodyZ_[i]);
+    }
+    const double cx = (lo[0] + hi[0]) / 2, cy = (lo[1] + hi[1]) / 2, cz = (lo[2] + hi[2]) / 2;
+    const double hx = (hi[0] - lo[0]) / 2, hy = (hi[1] - lo[1]) / 2, hz = (hi[2] - lo[2]) / 2;
+    const Target target{ cx, cy, cz, hx, hy, hz, limit };
+
+    // 1. 遍历：被接受的节点直接追加，打开的叶节点先记下，节点全部追加后再追加其天体
+    list.clear();
+    uint32_t stack[7 * kMaxDepth + 8];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const uint32_t node = stack[--top];
+        // 与组的天体区间相交的节点包含组内天体，总是打开
+        const bool containsGroup = bodyBegin_[node] < g1 && g0 < bodyBegin_[node] + bodyCount_[node];
+        if (!containsGroup) {
+            // 质心到包围盒的最近距离不大于它到组内任一天体的距离
+            const double dx = std::max(0.0, std::abs(comX_[node] - cx) - hx);
+            const double dy = std::max(0.0, std::abs(comY_[node] - cy) - hy);
+            const double dz = std::max(0.0, std::abs(comZ_[node] - cz) - hz);
+            if (accepts(node, std::sqrt(dx * dx + dy * dy + dz * dz), target, params)) {
+                list.x.push_back(comX_[node]);
+                list.y.push_back(comY_[node]);
+                list.z.push_back(comZ_[node]);
+                list.mass.push_back(mass_[node]);
+                list.radius.push_back(0.0);
+                if (quadrupole_) {
+                    list.qxx.push_back(qxx_[node]); list.qxy.push_back(qxy_[node]);
+                    list.qxz.push_back(qxz_[node]); list.qyy.push_back(qyy_[node]);
+                    list.qyz.push_back(qyz_[node]); list.qzz.push_back(qzz_[node]);
+                }
+                continue;
+            }
+        }
+        if (childCount_[node] > 0) {
+            for (uint32_t c = firstChild_[node], end = c + childCount_[node]; c < end; ++c) {
+                stack[top++] = c;
+            }
+        } else {
+            list.leaves.push_back(node);
+        }
+    }
+    list.nodes = list.x.size();
+    for (const uint32_t node : list.leaves) {
+        const uint32_t begin = bodyBegin_[node];
+        const uint32_t end = begin + bodyCount_[node];
+        list.x.insert(list.x.end(), bodyX_.data() + begin, bodyX_.data() + end);
+        list.y.insert(list.y.end(), bodyY_.data() + begin, bodyY_.data() + end);
+        list.z.insert(list.z.end(), bodyZ_.data() + begin, bodyZ_.data() + end);
+        list.mass.insert(list.mass.end(), bodyMass_.data() + begin, bodyMass_.data() + end);
+        list.radius.insert(list.radius.end(), bodyRadius_.data() + begin, bodyRadius_.data() + end);
+    }
+
+    // 2. 对组内全部天体求和交互表：节点部分目标半径取0，天体部分目标自身距离为0被策略掩码排除
+    const size_t nodes = list.nodes;
+    const size_t total = list.x.size();
+    const size_t targets = g1 - g0;
+    list.ax.assign(targets, 0.0);
+    list.ay.assign(targets, 0.0);
+    list.az.assign(targets, 0.0);
+    if (precision == ForcePrecision::Double) {
+        const DirectSumArgs args{ list.x.data(), list.y.data(), list.z.data(), list.mass.data(),
+                                  list.radius.data(), nullptr, nullptr, nullptr,
+                                  params.gravityConstant, params.softening2 };
+        for (size_t t = 0; t < targets; ++t) {
+            const uint32_t slot = g0 + static_cast<uint32_t>(t);
+            double acc[3] = { 0, 0, 0 };
+            kernels.leafSum(args, 0, nodes, bodyX_[slot], bodyY_[slot], bodyZ_[slot], 0.0, acc);
+            kernels.leafSum(args, nodes, total, bodyX_[slot], bodyY_[slot], bodyZ_[slot],
+                            bodyRadius_[slot], acc);
+            list.ax[t] = acc[0];
+            list.ay[t] = acc[1];
+            list.az[t] = acc[2];
+        }
+    } else {
+        // Mixed：坐标平移到组中心后表示为两个float之和；Float：坐标直接转换
+        const bool split = precision == ForcePrecision::Mixed;
+        const double ox = split ? cx : 0.0, oy = split ? cy : 0.0, oz = split ? cz : 0.0;
+        auto convert = [&](const double* px, const double* py, const double* pz, size_t count,
+                           AlignedVector<float>& fx, AlignedVector<float>& fy, AlignedVector<float>& fz,
+                           AlignedVector<float>& fxlo, AlignedVector<float>& fylo, AlignedVector<float>& fzlo) {
+            for (auto* array : { &fx, &fy, &fz, &fxlo, &fylo, &fzlo }) array->resize(count);
+            for (size_t k = 0; k < count; ++k) {
+                const double dx = px[k] - ox, dy = py[k] - oy, dz = pz[k] - oz;
+                fx[k] = static_cast<float>(dx);
+                fy[k] = static_cast<float>(dy);
+                fz[k] = static_cast<float>(dz);
+                fxlo[k] = static_cast<float>(dx - fx[k]);
+                fylo[k] = static_cast<float>(dy - fy[k]);
+                fzlo[k] = static_cast<float>(dz - fz[k]);
+            }
+        };
+        convert(list.x.data(), list.y.data(), list.z.data(), total,
+                list.fx, list.fy, list.fz, list.fxlo, list.fylo, list.fzlo);
+        convert(bodyX_.data() + g0, bodyY_.data() + g0, bodyZ_.data() + g0, targets,
+                list.tx, list.ty, list.tz, list.txlo, list.tylo, list.tzlo);
+        list.gm.resize(total);
+        list.fradius.resize(total);
+        for (size_t k = 0; k < total; ++k) {
+            list.gm[k] = static_cast<float>(params.gravityConstant * list.mass[k]);
+            list.fradius[k] = static_cast<float>(list.radius[k]);
+        }
+        list.tradius.resize(targets);
+        list.zeros.assign(targets, 0.0f);
+        for (size_t t = 0; t < targets; ++t) list.tradius[t] = static_cast<float>(bodyRadius_[g0 + t]);
+
+        const DirectSumFloatFn kernel = split ? kernels.directSumSplit : kernels.directSumFloat;
+        const float eps2 = static_cast<float>(params.softening2);
+        for (const bool bodies : { false, true }) {
+            const size_t j = bodies ? nodes : 0;
+            const FloatSources src{ list.fx.data() + j, list.fy.data() + j, list.fz.data() + j,
+                                    list.gm.data() + j, list.fradius.data() + j,
+                                    (bodies ? total : nodes) - j,
+                                    split ? list.fxlo.data() + j : nullptr,
+                                    split ? list.fylo.data() + j : nullptr,
+                                    split ? list.fzlo.data() + j : nullptr, eps2 };
+            const FloatTargets tgt{ list.tx.data(), list.ty.data(), list.tz.data(),
+                                    bodies ? list.tradius.data() : list.zeros.data(), targets,
+                                    list.ax.data(), list.ay.data(), list.az.data(),
+                                    split ? list.txlo.data() : nullptr,
+                                    split ? list.tylo.data() : nullptr,
+                                    split ? list.tzlo.data() : nullptr };
+            kernel(src, tgt);
+        }
+    }
+
+    const QuadrupoleArgs quadrupole{ list.x.data(), list.y.data(), list.z.data(),
+                                     list.qxx.data(), list.qxy.data(), list.qxz.data(),
+                                     list.qyy.data(), list.qyz.data(), list.qzz.data(),
+                                     params.gravityConstant };
+    for (size_t t = 0; t < targets; ++t) {
+        const uint32_t slot = g0 + static_cast<uint32_t>(t);
+        double acc[3] = { list.ax[t], list.ay[t], list.az[t] };
+        if (quadrupole_) {
+            kernels.quadrupoleSum(quadrupole, 0, nodes, bodyX_[slot], bodyY_[slot], bodyZ_[slot], acc);
+        }
+        emit(slot, Vector3D(acc[0], acc[1], acc[2]));
+    }
+    return static_cast<uint32_t>(total * targets);
+}
+
+void LinearOctree::computeAccelerations(BodyStore& store, const TreeForceParams& params,
+                                        ForcePrecision precision, const KernelPolicy& policy,
+                                        const VelocityKick* kick, CostZones* zones) const {
+    if (empty()) return;
+    const size_t n = store.size();
+    const KernelSet& kernels = ForceKernels::selectKernels(ForceKernels::activeSimdLevel(), policy);
+
+    if (!groups_.empty()) {
+        // 分组遍历：工作项是组，各组的天体互不重叠
+        if (lists_.size() < static_cast<size_t>(omp_get_max_threads())) lists_.resize(omp_get_max_threads());
+        auto emit = [&](uint32_t slot, const Vector3D& a) {
+            const uint32_t body = order_[slot];
+            store.setAcceleration(body, a);
+            if (kick) kick->apply(body, a.x(), a.y(), a.z());
+        };
+        auto work = [&](size_t k) {
+            const uint32_t group = groups_[k];
+            const double limit = relativeLimit(store, bodyBegin_[group], bodyBegin_[group] + bodyCount_[group], params);
+            return walkGroup(group, params, limit, kernels, precision, lists_[omp_get_thread_num()], emit);
+        };
+        if (zones) {
+            zones->run(order_.data(), groupStart_.data(), groups_.size(), work);
+        } else {
+            #pragma omp parallel for schedule(dynamic, 4)
+            for (ptrdiff_t k = 0; k < static_cast<ptrdiff_t>(groups_.size()); ++k) work(static_cast<size_t>(k));
+        }
+        return;
+    }
+
+    const bool floatCoordinates = precision == ForcePrecision::Float;
+    withPolicy(policy, [&](auto p) {
+        using P = decltype(p);
+        // 按排序后的顺序处理，各天体互不依赖：加速度和kick只写本天体
+        auto work = [&](size_t slot) {
+            uint32_t interactions = 0;
+            const double limit = relativeLimit(store, static_cast<uint32_t>(slot), static_cast<uint32_t>(slot) + 1, params);
+            const Vector3D a = precision == ForcePrecision::Double
+                ? accelerationOn<double, P>(slot, params, limit, kernels, floatCoordinates, interactions)
+                : accelerationOn<float, P>(slot, params, limit, kernels, floatCoordinates, interactions);
+            const uint32_t body = order_[slot];
+            store.setAcceleration(body, a);
+            if (kick) kick->apply(body, a.x(), a.y(), a.z());
+            return interactions;
+        };
+        if (zones) {
+            zones->run(order_.data(), n, work);
+        } else {
+            #pragma omp parallel for schedule(dynamic, 64)
+            for (ptrdiff_t k = 0; k < static_cast<ptrdiff_t>(n); ++k) work(static_cast<size_t>(k));
+        }
+    });
+}
+
+} // namespace GEngine
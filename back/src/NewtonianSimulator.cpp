@@ -1,103 +1,204 @@
 #include "../include/NewtonianSimulator.hpp"
 #include "../include/Config.hpp"
+#include "../include/ForceKernels.hpp"
+#include "../include/Hardware.hpp"
 #include <algorithm>
-#include <iostream>
+#include <cstddef>
+#include <omp.h>
 
 namespace GEngine {
 
 void NewtonianSimulator::addBody(std::shared_ptr<CelestialBody> body) {
-    bodies_.push_back(body);
+    bodies_.add(*body);
 }
 
 void NewtonianSimulator::removeBody(const std::string& name) {
-    bodies_.erase(
-        std::remove_if(bodies_.begin(), bodies_.end(),
-            [&name](const auto& body) { return body->getName() == name; }),
-        bodies_.end()
-    );
+    bodies_.removeByName(name);
 }
 
 void NewtonianSimulator::clear() {
     bodies_.clear();
 }
 
-void NewtonianSimulator::step() {
+void NewtonianSimulator::computeForcesDirect(const VelocityKick* kick) {
     const auto& config = SimulationConfig::getInstance();
-    
-    #pragma omp parallel for
-    for (size_t i = 0; i < bodies_.size(); ++i) {
-        Vector3D totalForce(0, 0, 0);
-        for (size_t j = 0; j < bodies_.size(); ++j) {
-            if (i != j) {
-                Vector3D r = bodies_[j]->getPosition() - bodies_[i]->getPosition();
-                double distance = r.magnitude();
-                
-                if (distance > (bodies_[i]->getRadius() + bodies_[j]->getRadius())) {
-                    double forceMagnitude = config.gravityConstant * 
-                                          bodies_[i]->getMass() * 
-                                          bodies_[j]->getMass() / 
-                                          (distance * distance);
-                    totalForce = totalForce + r.normalize() * forceMagnitude;
-                }
+    const size_t n = bodies_.size();
+    const KernelSet& kernels = ForceKernels::selectKernels(ForceKernels::activeSimdLevel(),
+                                                           ForceKernels::activePolicy());
+    DirectSumArgs args{
+        bodies_.px(), bodies_.py(), bodies_.pz(),
+        bodies_.mass(), bodies_.radius(),
+        bodies_.ax(), bodies_.ay(), bodies_.az(),
+        config.gravityConstant,
+        config.softeningLength * config.softeningLength
+    };
+
+    // directTileSize: 0按L1容量自动分块，负数不分块
+    size_t tile = config.directTileSize == 0 ? ForceKernels::autoSourceTile()
+                : config.directTileSize < 0 ? 0
+                : static_cast<size_t>(config.directTileSize);
+    const std::vector<DirectSumArgs> nodeArgs = replicas_.nodeArgs(args);
+    ForceKernels::directSumAll(kernels, ForceKernels::activePrecision(), args, n, tile, kick,
+                               nodeArgs.empty() ? nullptr : &nodeArgs);
+}
+
+void NewtonianSimulator::computeForcesSymmetric(const VelocityKick* kick) {
+    const auto& config = SimulationConfig::getInstance();
+    const size_t n = bodies_.size();
+    const KernelSet& kernels = ForceKernels::selectKernels(ForceKernels::activeSimdLevel(),
+                                                           ForceKernels::activePolicy());
+    const double softening2 = config.softeningLength * config.softeningLength;
+    DirectSumArgs sources{};
+    sources.x = bodies_.px(); sources.y = bodies_.py(); sources.z = bodies_.pz();
+    sources.mass = bodies_.mass(); sources.radius = bodies_.radius();
+    const std::vector<DirectSumArgs> nodeArgs = replicas_.nodeArgs(sources);
+    const int threads = omp_get_max_threads();
+
+    // 每个线程一份 3*n 的加速度缓冲区，跨步复用
+    if (threadAcc_.size() < static_cast<size_t>(threads)) {
+        threadAcc_.resize(threads);
+    }
+
+    // 第i行有 n-1-i 个天体对；把第p行和第n-1-p行折叠成一个任务，
+    // 每个任务恰好 n-1 对，静态调度即可均衡
+    const ptrdiff_t folded = static_cast<ptrdiff_t>((n + 1) / 2);
+
+    #pragma omp parallel
+    {
+        auto& acc = threadAcc_[omp_get_thread_num()];
+        acc.assign(3 * n, 0.0);
+        DirectSumArgs args{
+            bodies_.px(), bodies_.py(), bodies_.pz(),
+            bodies_.mass(), bodies_.radius(),
+            acc.data(), acc.data() + n, acc.data() + 2 * n,
+            config.gravityConstant, softening2
+        };
+        if (!nodeArgs.empty()) {
+            // 源天体读本节点副本
+            const DirectSumArgs& local =
+                nodeArgs[std::min<size_t>(Hardware::currentNumaNode(), nodeArgs.size() - 1)];
+            args.x = local.x; args.y = local.y; args.z = local.z;
+            args.mass = local.mass; args.radius = local.radius;
+        }
+
+        #pragma omp for schedule(static)
+        for (ptrdiff_t p = 0; p < folded; ++p) {
+            size_t lo = static_cast<size_t>(p);
+            size_t hi = n - 1 - lo;
+            kernels.symmetricRows(args, lo, lo + 1, n);
+            if (hi != lo) {
+                kernels.symmetricRows(args, hi, hi + 1, n);
+            }
+        }
+        // omp for 末尾的隐式屏障保证所有缓冲区已写完
+
+        const int used = omp_get_num_threads();
+        double* ax = bodies_.ax();
+        double* ay = bodies_.ay();
+        double* az = bodies_.az();
+        #pragma omp for schedule(static)
+        for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(n); ++i) {
+            double sx = 0, sy = 0, sz = 0;
+            for (int t = 0; t < used; ++t) {
+                const double* buf = threadAcc_[t].data();
+                sx += buf[i];
+                sy += buf[n + i];
+                sz += buf[2 * n + i];
             }
+            ax[i] = sx;
+            ay[i] = sy;
+            az[i] = sz;
+            if (kick) kick->apply(i, sx, sy, sz);
         }
-        bodies_[i]->setAcceleration(totalForce * (1.0 / bodies_[i]->getMass()));
     }
+}
 
-    #pragma omp parallel for
-    for (size_t i = 0; i < bodies_.size(); ++i) {
-        bodies_[i]->updateState(config.timeStep);
+void NewtonianSimulator::computeForces(const VelocityKick* kick) {
+    const auto& config = SimulationConfig::getInstance();
+    if (config.numaReplicas) {
+        replicas_.refresh(bodies_);
+    } else {
+        replicas_.clear();
     }
+    if (config.symmetricForces) {
+        computeForcesSymmetric(kick);
+    } else {
+        computeForcesDirect(kick);
+    }
+}
 
-    // 3. 碰撞检测
+void NewtonianSimulator::step() {
+    const auto& config = SimulationConfig::getInstance();
+    const double dt = config.timeDirectionForward ? config.timeStep : -config.timeStep;
+
+    // 按配置绑定线程；增删天体后由工作线程重新首次写入数组
+    Placement::applyAffinity(Placement::parseAffinity(config.threadAffinity));
+    bodies_.placeForThreads();
+
+    // 0. 首步或天体/配置变化后，先求出当前位置的加速度
+    if (!bodies_.accelerationsValid(config.revision())) {
+        computeForces(nullptr);
+    }
+
+    // 1. 按配置的积分器推进dt，返回时加速度对应新位置
+    Integrators::select(integrator_, config.integrator, config.integratorTolerance);
+    integrator_->step(bodies_, dt, [this](const VelocityKick* kick) { computeForces(kick); });
+    bodies_.markAccelerationsValid(config.revision());
+
+    // 2. 碰撞检测
     detectCollisions();
 }
 
 void NewtonianSimulator::reset() {
-    for (auto& body : bodies_) {
-        body->setAcceleration(Vector3D(0, 0, 0));
-        body->setVelocity(Vector3D(0, 0, 0));
-    }
+    bodies_.resetMotion();
 }
 
 nlohmann::json NewtonianSimulator::getSystemState() const {
-    nlohmann::json state = nlohmann::json::array();
-    for (const auto& body : bodies_) {
-        state.push_back(body->toJson());
-    }
-    return state;
+    return bodies_.toJson();
 }
 
 std::vector<std::shared_ptr<CelestialBody>> NewtonianSimulator::getBodies() const {
-    return bodies_;
+    return bodies_.makeBodies();
 }
 
 void NewtonianSimulator::configure(const nlohmann::json& config) {
     SimulationConfig::getInstance().loadFromJson(config);
 }
 
+nlohmann::json NewtonianSimulator::getDiagnostics() const {
+    return {
+        {"bodyStore", bodies_.placementJson()},
+        {"sourceReplicas", replicas_.nodeCount()},
+        {"integrator", integrator_ ? integrator_->toJson() : nlohmann::json()}
+    };
+}
+
+void NewtonianSimulator::calculateGravitationalFields(const Vector3D* positions, Vector3D* fields,
+                                                      size_t n) const {
+    #pragma omp parallel for schedule(static)
+    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(n); ++i) {
+        fields[i] = calculateGravitationalField(positions[i]);
+    }
+}
+
 void NewtonianSimulator::detectCollisions() {
+    const double* radius = bodies_.radius();
     for (size_t i = 0; i < bodies_.size(); ++i) {
         for (size_t j = i + 1; j < bodies_.size(); ++j) {
-            auto bodyA = bodies_[i];
-            auto bodyB = bodies_[j];
-
-            Vector3D diff = bodyA->getPosition() - bodyB->getPosition();
+            Vector3D diff = bodies_.position(i) - bodies_.position(j);
             double distance = diff.magnitude();
-            double collisionDist = bodyA->getRadius() + bodyB->getRadius();
+            double collisionDist = radius[i] + radius[j];
 
             if (distance < collisionDist) {
                 nlohmann::json collisionEvent;
                 collisionEvent["type"] = "collision";
                 collisionEvent["time"] = 0; 
-                collisionEvent["bodies"] = { bodyA->getName(), bodyB->getName() };
+                collisionEvent["bodies"] = { bodies_.name(i), bodies_.name(j) };
                 collisionEvent["distance"] = distance;
                 collisionEvent["message"] =
-                    "Collision occurred between " + bodyA->getName() + " and " + bodyB->getName();
+                    "Collision occurred between " + bodies_.name(i) + " and " + bodies_.name(j);
 
                 eventLog.push_back(collisionEvent);
-                
-                std::cout << "发生碰撞！！！！！！！！！！！！！！！！！！！！" << std::endl;
             }
         }
     }
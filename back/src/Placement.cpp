@@ -0,0 +1,191 @@
+#include "../include/Placement.hpp"
+#include "../include/Hardware.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <omp.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace GEngine {
+
+namespace {
+
+struct ThreadPlacement {
+    int thread;
+    int cpu;
+    int node;  // NUMA节点的内核编号
+};
+
+// 最近一次绑定的结果，供诊断接口读取
+std::mutex placementMutex;
+ThreadAffinity lastMode = ThreadAffinity::None;
+std::vector<ThreadPlacement> lastPlacement;
+
+// 按绑定方式排列的CPU序列，第t个线程绑定到 cpus[t % cpus.size()]
+std::vector<int> orderedCpus(ThreadAffinity mode) {
+    const auto& nodes = Hardware::numaNodes();
+    std::vector<int> cpus;
+    if (mode == ThreadAffinity::Compact) {
+        for (const auto& node : nodes) cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+    } else if (mode == ThreadAffinity::Scatter) {
+        size_t longest = 0;
+        for (const auto& node : nodes) longest = std::max(longest, node.cpus.size());
+        for (size_t k = 0; k < longest; ++k) {
+            for (const auto& node : nodes) {
+                if (k < node.cpus.size()) cpus.push_back(node.cpus[k]);
+            }
+        }
+    }
+    return cpus;
+}
+
+int currentCpu() {
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+} // namespace
+
+namespace Placement {
+
+ThreadAffinity parseAffinity(const std::string& name) {
+    if (name == "compact") return ThreadAffinity::Compact;
+    if (name == "scatter") return ThreadAffinity::Scatter;
+    return ThreadAffinity::None;
+}
+
+const char* affinityName(ThreadAffinity mode) {
+    switch (mode) {
+        case ThreadAffinity::Compact: return "compact";
+        case ThreadAffinity::Scatter: return "scatter";
+        default: return "none";
+    }
+}
+
+void applyAffinity(ThreadAffinity mode) {
+    thread_local ThreadAffinity applied = ThreadAffinity::None;
+    thread_local int appliedThreads = 0;
+    const int threads = omp_get_max_threads();
+    if (applied == mode && (mode == ThreadAffinity::None || appliedThreads == threads)) {
+        return;
+    }
+
+    const std::vector<int> cpus = orderedCpus(mode);
+    std::vector<ThreadPlacement> placement(threads);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        const int t = omp_get_thread_num();
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (cpus.empty()) {
+            // 解除绑定：允许在全部CPU上运行
+            for (const auto& node : Hardware::numaNodes()) {
+                for (int cpu : node.cpus) CPU_SET(cpu, &set);
+            }
+        } else {
+            CPU_SET(cpus[t % cpus.size()], &set);
+        }
+        sched_setaffinity(0, sizeof(set), &set);
+#endif
+        const int cpu = currentCpu();
+        placement[t] = ThreadPlacement{ t, cpu, Hardware::numaNodes()[Hardware::numaNodeOfCpu(cpu)].id };
+    }
+
+    applied = mode;
+    appliedThreads = threads;
+
+    std::lock_guard<std::mutex> lock(placementMutex);
+    lastMode = mode;
+    lastPlacement = std::move(placement);
+}
+
+nlohmann::json diagnostics() {
+    nlohmann::json nodes = nlohmann::json::array();
+    const auto& topology = Hardware::numaNodes();
+    for (const auto& node : topology) {
+        nodes.push_back({ {"node", node.id}, {"cpus", node.cpus} });
+    }
+
+    std::lock_guard<std::mutex> lock(placementMutex);
+    nlohmann::json threads = nlohmann::json::array();
+    for (const auto& p : lastPlacement) {
+        threads.push_back({ {"thread", p.thread}, {"cpu", p.cpu}, {"node", p.node} });
+    }
+    return {
+        {"numaNodes", nodes},
+        {"maxThreads", omp_get_max_threads()},
+        {"threadAffinity", affinityName(lastMode)},
+        {"threads", threads}
+    };
+}
+
+} // namespace Placement
+
+void SourceReplicas::refresh(const BodyStore& store) {
+    const size_t nodeCount = Hardware::numaNodes().size();
+    if (nodeCount <= 1) {
+        nodes_.clear();
+        return;
+    }
+    const size_t n = store.size();
+    nodes_.resize(nodeCount);
+    for (auto& r : nodes_) {
+        // 分配器不初始化元素，页面在下面由各节点的线程首次写入
+        r.x.resize(n); r.y.resize(n); r.z.resize(n);
+        r.mass.resize(n); r.radius.resize(n);
+        r.filled = false;
+    }
+
+    const int threads = omp_get_max_threads();
+    std::vector<int> threadNode(threads, -1);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        const int t = omp_get_thread_num();
+        const int used = omp_get_num_threads();
+        threadNode[t] = Hardware::currentNumaNode();
+        #pragma omp barrier
+
+        // 同一节点上的线程平分该节点副本的复制工作
+        const int node = threadNode[t];
+        int rank = 0, peers = 0;
+        for (int u = 0; u < used; ++u) {
+            if (threadNode[u] != node) continue;
+            if (u < t) ++rank;
+            ++peers;
+        }
+        Replica& r = nodes_[node];
+        const size_t begin = n * rank / peers;
+        const size_t end = n * (rank + 1) / peers;
+        std::copy(store.px() + begin, store.px() + end, r.x.begin() + begin);
+        std::copy(store.py() + begin, store.py() + end, r.y.begin() + begin);
+        std::copy(store.pz() + begin, store.pz() + end, r.z.begin() + begin);
+        std::copy(store.mass() + begin, store.mass() + end, r.mass.begin() + begin);
+        std::copy(store.radius() + begin, store.radius() + end, r.radius.begin() + begin);
+        if (rank == 0) r.filled = true;
+    }
+}
+
+std::vector<DirectSumArgs> SourceReplicas::nodeArgs(const DirectSumArgs& base) const {
+    std::vector<DirectSumArgs> args(nodes_.size(), base);
+    for (size_t node = 0; node < nodes_.size(); ++node) {
+        const Replica& r = nodes_[node];
+        if (!r.filled) continue;
+        args[node].x = r.x.data();
+        args[node].y = r.y.data();
+        args[node].z = r.z.data();
+        args[node].mass = r.mass.data();
+        args[node].radius = r.radius.data();
+    }
+    return args;
+}
+
+} // namespace GEngine
@@ -0,0 +1,12 @@
+// 本文件以 -mavx2 -mfma 编译，只在运行时检测到AVX2时调用
+#include "DirectSumKernel.hpp"
+
+namespace GEngine {
+namespace detail {
+
+void kernelTableAvx2(KernelSet (&table)[kPolicyCount]) {
+    fillKernelTable<Avx2D, Avx2F>(table);
+}
+
+} // namespace detail
+} // namespace GEngine
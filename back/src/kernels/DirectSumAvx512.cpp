@@ -0,0 +1,12 @@
+// 本文件以 -mavx512f -mfma 编译，只在运行时检测到AVX-512F时调用
+#include "DirectSumKernel.hpp"
+
+namespace GEngine {
+namespace detail {
+
+void kernelTableAvx512(KernelSet (&table)[kPolicyCount]) {
+    fillKernelTable<Avx512D, Avx512F>(table);
+}
+
+} // namespace detail
+} // namespace GEngine
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "../../include/ForceKernels.hpp"
+#include "../../include/ForcePolicies.hpp"
+#include "SimdTypes.hpp"
+
+namespace GEngine {
+namespace detail {
+namespace {
+
+// 一组天体对的引力系数 gm / (|r|^2 + eps^2)^(3/2)，不计入的天体对为0。
+// 按 ((gm * inv) * inv) * inv 的顺序相乘，避免单精度下 inv^3 下溢
+template <class V, class P>
+inline typename V::reg pairFactor(typename V::reg dx, typename V::reg dy, typename V::reg dz,
+                                  typename V::reg gm, typename V::reg radiusSum,
+                                  typename V::reg eps2) {
+    typename V::reg d2;
+    if constexpr (P::dimensions == 3) {
+        d2 = V::fmadd(dx, dx, V::fmadd(dy, dy, V::mul(dz, dz)));
+    } else {
+        d2 = V::fmadd(dx, dx, V::mul(dy, dy));
+    }
+    typename V::reg inv = V::rsqrt(P::softening::template apply<V>(d2, eps2));
+    typename V::reg s = V::mul(V::mul(V::mul(gm, inv), inv), inv);
+    return P::template mask<V>(d2, radiusSum, s);
+}
+
+// 源天体[j0, j1)对位于(xi, yi, zi)、半径为ri的目标产生的加速度，累加到fx/fy/fz。
+// 每次迭代处理V::width个源天体，尾部用同一策略的标量版本
+template <class V, class P>
+inline void accumulateRow(const DirectSumArgs& a, size_t j0, size_t j1,
+                          double xi, double yi, double zi, double ri,
+                          double& fx, double& fy, double& fz) {
+    using reg = typename V::reg;
+    using S = ScalarD;
+    const reg G = V::set1(a.gravityConstant);
+    const reg eps2 = V::set1(a.softening2);
+    const reg vxi = V::set1(xi), vyi = V::set1(yi), vzi = V::set1(zi), vri = V::set1(ri);
+    reg sx = V::zero(), sy = V::zero(), sz = V::zero();
+
+    size_t j = j0;
+    for (; j + V::width <= j1; j += V::width) {
+        reg dx = V::sub(V::loadu(a.x + j), vxi);
+        reg dy = V::sub(V::loadu(a.y + j), vyi);
+        reg dz = P::dimensions == 3 ? V::sub(V::loadu(a.z + j), vzi) : V::zero();
+        reg s = pairFactor<V, P>(dx, dy, dz, V::mul(G, V::loadu(a.mass + j)),
+                                 V::add(vri, V::loadu(a.radius + j)), eps2);
+        sx = V::fmadd(dx, s, sx);
+        sy = V::fmadd(dy, s, sy);
+        if constexpr (P::dimensions == 3) sz = V::fmadd(dz, s, sz);
+    }
+
+    fx = V::reduce(sx); fy = V::reduce(sy); fz = V::reduce(sz);
+    for (; j < j1; ++j) {
+        double dx = a.x[j] - xi;
+        double dy = a.y[j] - yi;
+        double dz = P::dimensions == 3 ? a.z[j] - zi : 0.0;
+        double s = pairFactor<S, P>(dx, dy, dz, a.gravityConstant * a.mass[j],
+                                    ri + a.radius[j], a.softening2);
+        fx += dx * s;
+        fy += dy * s;
+        fz += dz * s;
+    }
+}
+
+// 双精度直接求和核函数
+template <class V, class P>
+void directSumKernel(const DirectSumArgs& a, size_t i0, size_t i1, size_t j0, size_t j1) {
+    for (size_t i = i0; i < i1; ++i) {
+        double fx, fy, fz;
+        accumulateRow<V, P>(a, j0, j1, a.x[i], a.y[i], a.z[i], a.radius[i], fx, fy, fz);
+        a.ax[i] += fx;
+        a.ay[i] += fy;
+        a.az[i] += fz;
+    }
+}
+
+// 树叶节点的直接求和：单个目标对叶内源天体的加速度累加到acc[0..2]
+template <class V, class P>
+void leafSumKernel(const DirectSumArgs& a, size_t j0, size_t j1,
+                   double xi, double yi, double zi, double ri, double* acc) {
+    double fx, fy, fz;
+    accumulateRow<V, P>(a, j0, j1, xi, yi, zi, ri, fx, fy, fz);
+    acc[0] += fx;
+    acc[1] += fy;
+    acc[2] += fz;
+}
+
+// 四极项：d为目标指向节点质心的位移，a = G (5/2 (d^T Q d) d / r^7 - Q d / r^5)，累加到fx/fy/fz。
+// 二维策略下dz为0且不累加z分量
+template <class V, class P>
+inline void quadrupoleTerm(const QuadrupoleArgs& a, size_t j, typename V::reg G,
+                           typename V::reg dx, typename V::reg dy, typename V::reg dz,
+                           typename V::reg& fx, typename V::reg& fy, typename V::reg& fz) {
+    using reg = typename V::reg;
+    const reg xx = V::loadu(a.xx + j), xy = V::loadu(a.xy + j), xz = V::loadu(a.xz + j);
+    const reg yy = V::loadu(a.yy + j), yz = V::loadu(a.yz + j), zz = V::loadu(a.zz + j);
+    const reg qdx = V::fmadd(xx, dx, V::fmadd(xy, dy, V::mul(xz, dz)));
+    const reg qdy = V::fmadd(xy, dx, V::fmadd(yy, dy, V::mul(yz, dz)));
+    const reg qdz = V::fmadd(xz, dx, V::fmadd(yz, dy, V::mul(zz, dz)));
+    const reg dqd = V::fmadd(dx, qdx, V::fmadd(dy, qdy, V::mul(dz, qdz)));
+    const reg inv = V::rsqrt(V::fmadd(dx, dx, V::fmadd(dy, dy, V::mul(dz, dz))));
+    const reg inv2 = V::mul(inv, inv);
+    const reg inv5 = V::mul(V::mul(G, V::mul(inv2, inv2)), inv);
+    const reg radial = V::mul(V::mul(V::set1(2.5), dqd), V::mul(inv2, inv5));
+    fx = V::fmadd(radial, dx, V::fnmadd(inv5, qdx, fx));
+    fy = V::fmadd(radial, dy, V::fnmadd(inv5, qdy, fy));
+    if constexpr (P::dimensions == 3) fz = V::fmadd(radial, dz, V::fnmadd(inv5, qdz, fz));
+}
+
+// 树节点四极项的求和：单个目标对节点[j0, j1)，每次迭代处理V::width个节点，尾部用标量版本
+template <class V, class P>
+void quadrupoleSumKernel(const QuadrupoleArgs& a, size_t j0, size_t j1,
+                         double xi, double yi, double zi, double* acc) {
+    using reg = typename V::reg;
+    using S = ScalarD;
+    const reg G = V::set1(a.gravityConstant);
+    const reg vxi = V::set1(xi), vyi = V::set1(yi), vzi = V::set1(zi);
+    reg sx = V::zero(), sy = V::zero(), sz = V::zero();
+
+    size_t j = j0;
+    for (; j + V::width <= j1; j += V::width) {
+        const reg dx = V::sub(V::loadu(a.x + j), vxi);
+        const reg dy = V::sub(V::loadu(a.y + j), vyi);
+        const reg dz = P::dimensions == 3 ? V::sub(V::loadu(a.z + j), vzi) : V::zero();
+        quadrupoleTerm<V, P>(a, j, G, dx, dy, dz, sx, sy, sz);
+    }
+
+    double fx = V::reduce(sx), fy = V::reduce(sy), fz = V::reduce(sz);
+    for (; j < j1; ++j) {
+        quadrupoleTerm<S, P>(a, j, a.gravityConstant, a.x[j] - xi, a.y[j] - yi,
+                             P::dimensions == 3 ? a.z[j] - zi : 0.0, fx, fy, fz);
+    }
+    acc[0] += fx;
+    acc[1] += fy;
+    acc[2] += fz;
+}
+
+// 单精度直接求和核函数：每次迭代处理V::width个源天体。
+// Split为true时坐标是两个float之和，位移按 (hi_j - hi_i) + (lo_j - lo_i) 计算
+template <class V, class P, bool Split>
+void directSumFloatKernel(const FloatSources& src, const FloatTargets& tgt) {
+    using reg = typename V::reg;
+    using S = ScalarF;
+    const reg eps2 = V::set1(src.softening2);
+
+    for (size_t i = 0; i < tgt.count; ++i) {
+        const float xi = tgt.x[i], yi = tgt.y[i], zi = tgt.z[i], ri = tgt.radius[i];
+        const float xli = Split ? tgt.xlo[i] : 0.0f;
+        const float yli = Split ? tgt.ylo[i] : 0.0f;
+        const float zli = Split ? tgt.zlo[i] : 0.0f;
+        const reg vxi = V::set1(xi), vyi = V::set1(yi), vzi = V::set1(zi), vri = V::set1(ri);
+        const reg vxli = V::set1(xli), vyli = V::set1(yli), vzli = V::set1(zli);
+        reg sx = V::zero(), sy = V::zero(), sz = V::zero();
+
+        size_t j = 0;
+        for (; j + V::width <= src.count; j += V::width) {
+            reg dx = V::sub(V::loadu(src.x + j), vxi);
+            reg dy = V::sub(V::loadu(src.y + j), vyi);
+            reg dz = P::dimensions == 3 ? V::sub(V::loadu(src.z + j), vzi) : V::zero();
+            if constexpr (Split) {
+                dx = V::add(dx, V::sub(V::loadu(src.xlo + j), vxli));
+                dy = V::add(dy, V::sub(V::loadu(src.ylo + j), vyli));
+                if constexpr (P::dimensions == 3) dz = V::add(dz, V::sub(V::loadu(src.zlo + j), vzli));
+            }
+            reg s = pairFactor<V, P>(dx, dy, dz, V::loadu(src.gm + j),
+                                     V::add(vri, V::loadu(src.radius + j)), eps2);
+            sx = V::fmadd(dx, s, sx);
+            sy = V::fmadd(dy, s, sy);
+            if constexpr (P::dimensions == 3) sz = V::fmadd(dz, s, sz);
+        }
+
+        float fx = V::reduce(sx), fy = V::reduce(sy), fz = V::reduce(sz);
+        for (; j < src.count; ++j) {
+            float dx = src.x[j] - xi;
+            float dy = src.y[j] - yi;
+            float dz = P::dimensions == 3 ? src.z[j] - zi : 0.0f;
+            if constexpr (Split) {
+                dx += src.xlo[j] - xli;
+                dy += src.ylo[j] - yli;
+                if constexpr (P::dimensions == 3) dz += src.zlo[j] - zli;
+            }
+            float s = pairFactor<S, P>(dx, dy, dz, src.gm[j], ri + src.radius[j], src.softening2);
+            fx += dx * s;
+            fy += dy * s;
+            fz += dz * s;
+        }
+
+        tgt.ax[i] += fx;
+        tgt.ay[i] += fy;
+        tgt.az[i] += fz;
+    }
+}
+
+// 对称求和核函数：第i行只计算 j > i 的天体对，利用牛顿第三定律
+// 同时把等大反向的贡献累加到 ax[i] 和 ax[j]（ax/ay/az为线程私有缓冲区）
+template <class V, class P>
+void symmetricRowsKernel(const DirectSumArgs& a, size_t i0, size_t i1, size_t n) {
+    using reg = typename V::reg;
+    using S = ScalarD;
+    const reg G = V::set1(a.gravityConstant);
+    const reg eps2 = V::set1(a.softening2);
+
+    for (size_t i = i0; i < i1; ++i) {
+        const double xi = a.x[i], yi = a.y[i], zi = a.z[i], ri = a.radius[i], mi = a.mass[i];
+        const reg vxi = V::set1(xi), vyi = V::set1(yi), vzi = V::set1(zi);
+        const reg vri = V::set1(ri), vmi = V::set1(mi);
+        reg sx = V::zero(), sy = V::zero(), sz = V::zero();
+
+        size_t j = i + 1;
+        for (; j + V::width <= n; j += V::width) {
+            reg dx = V::sub(V::loadu(a.x + j), vxi);
+            reg dy = V::sub(V::loadu(a.y + j), vyi);
+            reg dz = P::dimensions == 3 ? V::sub(V::loadu(a.z + j), vzi) : V::zero();
+            reg t = pairFactor<V, P>(dx, dy, dz, G, V::add(vri, V::loadu(a.radius + j)), eps2);
+
+            reg si = V::mul(t, V::loadu(a.mass + j));
+            sx = V::fmadd(dx, si, sx);
+            sy = V::fmadd(dy, si, sy);
+
+            reg sj = V::mul(t, vmi);
+            V::storeu(a.ax + j, V::fnmadd(dx, sj, V::loadu(a.ax + j)));
+            V::storeu(a.ay + j, V::fnmadd(dy, sj, V::loadu(a.ay + j)));
+            if constexpr (P::dimensions == 3) {
+                sz = V::fmadd(dz, si, sz);
+                V::storeu(a.az + j, V::fnmadd(dz, sj, V::loadu(a.az + j)));
+            }
+        }
+
+        double fx = V::reduce(sx), fy = V::reduce(sy), fz = V::reduce(sz);
+        for (; j < n; ++j) {
+            double dx = a.x[j] - xi;
+            double dy = a.y[j] - yi;
+            double dz = P::dimensions == 3 ? a.z[j] - zi : 0.0;
+            double t = pairFactor<S, P>(dx, dy, dz, a.gravityConstant, ri + a.radius[j],
+                                        a.softening2);
+            fx += dx * t * a.mass[j];
+            fy += dy * t * a.mass[j];
+            fz += dz * t * a.mass[j];
+            a.ax[j] -= dx * t * mi;
+            a.ay[j] -= dy * t * mi;
+            a.az[j] -= dz * t * mi;
+        }
+
+        a.ax[i] += fx;
+        a.ay[i] += fy;
+        a.az[i] += fz;
+    }
+}
+
+// 为一种SIMD级别填充全部策略组合的分派表
+template <class VD, class VF>
+void fillKernelTable(KernelSet (&table)[kPolicyCount]) {
+    forEachPolicy([&](auto policy) {
+        using P = decltype(policy);
+        table[policyIndex<P>()] = KernelSet{
+            &directSumKernel<VD, P>,
+            &directSumFloatKernel<VF, P, false>,
+            &directSumFloatKernel<VF, P, true>,
+            &symmetricRowsKernel<VD, P>,
+            &leafSumKernel<VD, P>,
+            &quadrupoleSumKernel<VD, P>
+        };
+    });
+}
+
+} // namespace
+} // namespace detail
+} // namespace GEngine
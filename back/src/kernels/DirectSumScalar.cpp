@@ -0,0 +1,11 @@
+#include "DirectSumKernel.hpp"
+
+namespace GEngine {
+namespace detail {
+
+void kernelTableScalar(KernelSet (&table)[kPolicyCount]) {
+    fillKernelTable<ScalarD, ScalarF>(table);
+}
+
+} // namespace detail
+} // namespace GEngine
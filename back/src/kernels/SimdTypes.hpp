@@ -0,0 +1,164 @@
+#pragma once
+
+// 核函数使用的SIMD寄存器封装。每种指令集只在以相应编译选项构建的翻译单元中可见，
+// 核函数模板据此实例化，避免不同指令集的代码混入同一个函数。
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace GEngine {
+namespace detail {
+namespace {
+
+struct ScalarD {
+    using reg = double;
+    static constexpr size_t width = 1;
+
+    static reg zero() { return 0.0; }
+    static reg set1(double v) { return v; }
+    static reg loadu(const double* p) { return *p; }
+    static void storeu(double* p, reg a) { *p = a; }
+    static reg add(reg a, reg b) { return a + b; }
+    static reg sub(reg a, reg b) { return a - b; }
+    static reg mul(reg a, reg b) { return a * b; }
+    static reg fmadd(reg a, reg b, reg c) { return a * b + c; }
+    static reg fnmadd(reg a, reg b, reg c) { return c - a * b; }
+    static reg div(reg a, reg b) { return a / b; }
+    static reg sqrt(reg a) { return std::sqrt(a); }
+    static reg rsqrt(reg a) { return 1.0 / std::sqrt(a); }
+    // a > b 时取v，否则取0
+    static reg selectGreater(reg a, reg b, reg v) { return a > b ? v : 0.0; }
+    static double reduce(reg a) { return a; }
+};
+
+struct ScalarF {
+    using reg = float;
+    static constexpr size_t width = 1;
+
+    static reg zero() { return 0.0f; }
+    static reg set1(float v) { return v; }
+    static reg loadu(const float* p) { return *p; }
+    static reg add(reg a, reg b) { return a + b; }
+    static reg sub(reg a, reg b) { return a - b; }
+    static reg mul(reg a, reg b) { return a * b; }
+    static reg fmadd(reg a, reg b, reg c) { return a * b + c; }
+    static reg rsqrt(reg a) { return 1.0f / std::sqrt(a); }
+    static reg selectGreater(reg a, reg b, reg v) { return a > b ? v : 0.0f; }
+    static float reduce(reg a) { return a; }
+};
+
+#if defined(__AVX2__) && defined(__FMA__)
+struct Avx2D {
+    using reg = __m256d;
+    static constexpr size_t width = 4;
+
+    static reg zero() { return _mm256_setzero_pd(); }
+    static reg set1(double v) { return _mm256_set1_pd(v); }
+    static reg loadu(const double* p) { return _mm256_loadu_pd(p); }
+    static void storeu(double* p, reg a) { _mm256_storeu_pd(p, a); }
+    static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+    static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+    static reg fnmadd(reg a, reg b, reg c) { return _mm256_fnmadd_pd(a, b, c); }
+    static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+    static reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+    static reg rsqrt(reg a) { return _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(a)); }
+    static reg selectGreater(reg a, reg b, reg v) {
+        return _mm256_and_pd(_mm256_cmp_pd(a, b, _CMP_GT_OQ), v);
+    }
+    static double reduce(reg a) {
+        __m128d lo = _mm256_castpd256_pd128(a);
+        __m128d hi = _mm256_extractf128_pd(a, 1);
+        lo = _mm_add_pd(lo, hi);
+        return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+    }
+};
+// 单精度：近似倒数平方根加一次牛顿迭代，约22位有效精度
+struct Avx2F {
+    using reg = __m256;
+    static constexpr size_t width = 8;
+
+    static reg zero() { return _mm256_setzero_ps(); }
+    static reg set1(float v) { return _mm256_set1_ps(v); }
+    static reg loadu(const float* p) { return _mm256_loadu_ps(p); }
+    static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+    static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+    static reg rsqrt(reg a) {
+        reg y = _mm256_rsqrt_ps(a);
+        reg h = _mm256_mul_ps(_mm256_set1_ps(0.5f), a);
+        return _mm256_mul_ps(y, _mm256_fnmadd_ps(h, _mm256_mul_ps(y, y), _mm256_set1_ps(1.5f)));
+    }
+    static reg selectGreater(reg a, reg b, reg v) {
+        return _mm256_and_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ), v);
+    }
+    static float reduce(reg a) {
+        __m128 lo = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+        return _mm_cvtss_f32(_mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1)));
+    }
+};
+#endif
+
+#if defined(__AVX512F__)
+struct Avx512D {
+    using reg = __m512d;
+    static constexpr size_t width = 8;
+
+    static reg zero() { return _mm512_setzero_pd(); }
+    static reg set1(double v) { return _mm512_set1_pd(v); }
+    static reg loadu(const double* p) { return _mm512_loadu_pd(p); }
+    static void storeu(double* p, reg a) { _mm512_storeu_pd(p, a); }
+    static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+    static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_pd(a, b, c); }
+    static reg fnmadd(reg a, reg b, reg c) { return _mm512_fnmadd_pd(a, b, c); }
+    static reg div(reg a, reg b) { return _mm512_div_pd(a, b); }
+    static reg sqrt(reg a) { return _mm512_sqrt_pd(a); }
+    // 14位近似倒数平方根加两次牛顿迭代，精度与 1/sqrt 相差几个ulp，但不占用除法单元
+    static reg rsqrt(reg a) {
+        const reg half = _mm512_set1_pd(0.5), threeHalves = _mm512_set1_pd(1.5);
+        reg y = _mm512_rsqrt14_pd(a);
+        reg h = _mm512_mul_pd(half, a);
+        y = _mm512_mul_pd(y, _mm512_fnmadd_pd(h, _mm512_mul_pd(y, y), threeHalves));
+        y = _mm512_mul_pd(y, _mm512_fnmadd_pd(h, _mm512_mul_pd(y, y), threeHalves));
+        return y;
+    }
+    static reg selectGreater(reg a, reg b, reg v) {
+        return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(a, b, _CMP_GT_OQ), v);
+    }
+    static double reduce(reg a) { return _mm512_reduce_add_pd(a); }
+};
+struct Avx512F {
+    using reg = __m512;
+    static constexpr size_t width = 16;
+
+    static reg zero() { return _mm512_setzero_ps(); }
+    static reg set1(float v) { return _mm512_set1_ps(v); }
+    static reg loadu(const float* p) { return _mm512_loadu_ps(p); }
+    static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+    static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_ps(a, b, c); }
+    static reg rsqrt(reg a) {
+        reg y = _mm512_rsqrt14_ps(a);
+        reg h = _mm512_mul_ps(_mm512_set1_ps(0.5f), a);
+        return _mm512_mul_ps(y, _mm512_fnmadd_ps(h, _mm512_mul_ps(y, y), _mm512_set1_ps(1.5f)));
+    }
+    static reg selectGreater(reg a, reg b, reg v) {
+        return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(a, b, _CMP_GT_OQ), v);
+    }
+    static float reduce(reg a) { return _mm512_reduce_add_ps(a); }
+};
+#endif
+
+} // namespace
+} // namespace detail
+} // namespace GEngine